@@ -57,6 +57,16 @@ constexpr plai::Duration to_duration(double secs) noexcept {
 
 }  // namespace
 
+const std::map<std::string, plai::logs::Level>& log_levels() {
+    using enum plai::logs::Level;
+    static const std::map<std::string, plai::logs::Level> out{{"trace", Trace},
+                                                              {"debug", Debug},
+                                                              {"info", Info},
+                                                              {"warn", Warn},
+                                                              {"error", Err}};
+    return out;
+}
+
 Cli parse_cli(int argc, char** argv) {
     auto parser = CLI::App("simple media player");
     argv = parser.ensure_utf8(argv);
@@ -70,12 +80,6 @@ Cli parse_cli(int argc, char** argv) {
     double img_dur = 1.0;
     double blend = 1.0;
     WatermarkPos wm_pos{WatermarkPos::Bl};
-    using enum plai::logs::Level;
-    const std::map<std::string, plai::logs::Level> log_mapping{{"trace", Trace},
-                                                               {"debug", Debug},
-                                                               {"info", Info},
-                                                               {"warn", Warn},
-                                                               {"error", Err}};
     using enum WatermarkPos;
     const std::map<std::string, WatermarkPos> wm_pos_mapping{
         {"tl", Tl}, {"tm", Tm}, {"tr", Tr}, {"ml", Ml}, {"mm", Mm},
@@ -83,12 +87,20 @@ Cli parse_cli(int argc, char** argv) {
     };
 
     parser.add_option("-l,--loglevel", out.log_level, "Log level")
-        ->transform(CLI::CheckedTransformer(log_mapping, CLI::ignore_case));
+        ->transform(CLI::CheckedTransformer(log_levels(), CLI::ignore_case));
     parser.add_option("--logfile", out.log_file,
                       "Log file path. If '-' (default) or '' stderr is used");
     parser.add_option("-d,--db", out.db,
                       "Database path. Use ':memory:' for in-memory database. "
                       "Default: ':memory:'.");
+    parser.add_option("--media-dir", out.media_dir,
+                      "Store media as files in this directory instead of the "
+                      "database given by --db.");
+    parser.add_flag("--rebuild-db", out.rebuild_db,
+                    "Rebuild a database created by an older version once, so "
+                    "that the space of removed media can be given back. "
+                    "Delays startup and needs free space for two copies of "
+                    "the database.");
     parser.add_option(
         "-s,--socket", out.socket,
         plai::format("Path to API unix socket. Default '{}'", out.socket));
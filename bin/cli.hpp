@@ -1,6 +1,7 @@
 #pragma once
 
 #include <filesystem>
+#include <map>
 #include <plai/frontend/type.hpp>
 #include <plai/logs/logs.hpp>
 #include <plai/time.hpp>
@@ -11,6 +12,7 @@ namespace plaibin {
 struct Cli {
     std::string accel{"sw"};
     std::string db;
+    std::string media_dir;
     std::string socket;
     std::string watermark;
     plai::RenderTarget watermark_tgt{};
@@ -21,6 +23,7 @@ struct Cli {
     std::filesystem::path log_file{"-"};
     bool fullscreen{false};
     bool list_accel{};
+    bool rebuild_db{};
 };
 
 class Exit : public std::exception {
@@ -33,6 +36,11 @@ class Exit : public std::exception {
     int m_code;
 };
 
+/**
+ * \brief Values of the `--loglevel` options by name
+ * */
+const std::map<std::string, plai::logs::Level>& log_levels();
+
 Cli parse_cli(int argc, char** argv);
 
 }  // namespace plaibin
@@ -0,0 +1,90 @@
+#include "cli.hpp"
+
+#include <CLI/CLI.hpp>
+#include <filesystem>
+#include <plai/format.hpp>
+#include <plai/logs/logs.hpp>
+#include <plai/store.hpp>
+#include <plai/store_import.hpp>
+#include <plai/time.hpp>
+
+namespace plaibin {
+namespace {
+namespace stdfs = std::filesystem;
+
+struct ImportCli {
+    stdfs::path dir;
+    std::string db;
+    std::string media_dir;
+    size_t jobs{plai::ImportOpts{}.jobs};
+    size_t batch_mib{plai::ImportOpts{}.batch_bytes >> 20};
+    plai::logs::Level log_level{plai::logs::Level::Info};
+};
+
+ImportCli parse_import_cli(int argc, char** argv) {
+    auto parser = CLI::App("import a directory of media into a store");
+    argv = parser.ensure_utf8(argv);
+    ImportCli out{};
+    parser.add_option("dir", out.dir,
+                      "Directory to import. The path of a file relative to it "
+                      "is its key, e.g. 'image/logo.png'. Files outside "
+                      "image/ and video/ or nested deeper are skipped.")
+        ->required()
+        ->check(CLI::ExistingDirectory);
+    // exactly one store to import to, an in-memory one would be discarded
+    auto* target = parser.add_option_group("store", "Store to import to");
+    target->add_option("-d,--db", out.db, "Database to import to");
+    target->add_option("--media-dir", out.media_dir,
+                       "Store media as files in this directory instead");
+    target->require_option(1);
+    parser
+        .add_option(
+            "-j,--jobs", out.jobs,
+            plai::format("Files hashed in parallel. Default: {}", out.jobs))
+        ->check(CLI::PositiveNumber);
+    parser.add_option(
+        "--batch", out.batch_mib,
+        plai::format("MiB of files stored per transaction, larger files are "
+                     "streamed. Default: {}",
+                     out.batch_mib));
+    parser.add_option("-l,--loglevel", out.log_level, "Log level")
+        ->transform(CLI::CheckedTransformer(log_levels(), CLI::ignore_case));
+    try {
+        parser.parse(argc, argv);
+    } catch (const CLI::ParseError& e) { throw Exit(parser.exit(e)); }
+    return out;
+}
+
+int run(const ImportCli& args) {
+    plai::logs::init(args.log_level);
+    auto store = args.media_dir.empty() ? plai::sqlite_store(args.db)
+                                        : plai::fs_store(args.media_dir);
+    auto start = plai::Clock::now();
+    auto stats = plai::import_dir(
+        *store, args.dir,
+        {.jobs = args.jobs, .batch_bytes = args.batch_mib << 20});
+    auto secs = std::chrono::duration<double>(plai::Clock::now() - start);
+    plai::println(
+        "imported {} files ({:.1f} MiB), linked {}, skipped {}, ignored {} in "
+        "{:.2f} s ({:.1f} MiB/s)",
+        stats.imported, static_cast<double>(stats.bytes) / (1 << 20),
+        stats.linked, stats.skipped, stats.ignored, secs.count(),
+        static_cast<double>(stats.bytes) / (1 << 20) / secs.count());
+    return EXIT_SUCCESS;
+}
+
+int do_main(int argc, char** argv) {
+    try {
+        return run(parse_import_cli(argc, argv));
+    } catch (const Exit& e) {
+        return e.code();
+    } catch (const std::exception& e) {
+        plai::println(stderr, "{}", e.what());
+        return EXIT_FAILURE;
+    }
+}
+
+}  // namespace
+}  // namespace plaibin
+
+int main(int argc, char** argv) { return ::plaibin::do_main(argc, argv); }
@@ -1,28 +1,54 @@
 #include <csignal>
+#include <future>
 #include <plai.hpp>
+#include <plai/util/defer.hpp>
 
 #include "cli.hpp"
 
 namespace plaibin {
 using namespace std::literals;
 
-plai::media::Media read_media(plai::Store& store,
-                              const plai::net::MediaListEntry& entry) {
+std::string full_key(const plai::net::MediaListEntry& entry) {
     const auto& [type, key] = entry;
-    auto full_key =
-        plai::format("{}/{}", plai::net::serialize_media_type(type), key);
-    return plai::media::Media(store.read(full_key));
+    return plai::format("{}/{}", plai::net::serialize_media_type(type), key);
 }
 
+/**
+ * \brief Media bytes read from the store while the media plays
+ * */
+class StoredMedia final : public plai::media::ByteSource {
+ public:
+    explicit StoredMedia(std::unique_ptr<plai::StoreReader> reader) noexcept
+        : m_reader(std::move(reader)) {}
+
+    size_t size() const noexcept override { return m_reader->size(); }
+
+    size_t read(size_t offset, std::span<uint8_t> out) override {
+        return m_reader->read(offset, out);
+    }
+
+ private:
+    std::unique_ptr<plai::StoreReader> m_reader;
+};
+
 class Playlist final : public plai::play::MediaSrc {
+    /**
+     * \brief Bytes of the next entry read ahead while one plays
+     *
+     * Only read to get them into the caches. The reader of an entry is opened
+     * when it starts, so that it plays what is stored by then, and no reader
+     * holds on to its snapshot while waiting.
+     * */
+    static constexpr size_t PREFETCH_BYTES = 1024 * 1024;
+
     std::mutex m_mut{};
-    plai::Store* m_store;
+    plai::AsyncStore* m_store;
     std::vector<plai::net::MediaListEntry> m_keys{};
     size_t m_idx{0};
     bool m_repeat{true};
 
  public:
-    Playlist(plai::Store* store) : m_store(store) { assert(store); }
+    Playlist(plai::AsyncStore* store) : m_store(store) { assert(store); }
 
     bool set_entries(std::vector<plai::net::MediaListEntry> entries) {
         auto lk = std::lock_guard(m_mut);
@@ -37,13 +63,29 @@ class Playlist final : public plai::play::MediaSrc {
     }
 
     std::optional<plai::media::Media> next_media() override {
-        auto lk = std::lock_guard(m_mut);
-        if (m_keys.empty()) return std::nullopt;
-        if (m_idx >= m_keys.size()) {
-            if (!m_repeat) return std::nullopt;
-            m_idx = 0;
+        auto lk = std::unique_lock(m_mut);
+        auto idx = next_idx();
+        if (!idx) return std::nullopt;
+        auto key = full_key(m_keys.at(*idx));
+        m_idx = *idx + 1;
+        auto reader = m_store->async_reader(key, boost::asio::use_future);
+        if (auto next = next_idx()) {
+            // a missing entry fails once it is played
+            m_store->async_read_range(
+                full_key(m_keys.at(*next)), 0, PREFETCH_BYTES,
+                [](std::exception_ptr /*err*/, std::vector<uint8_t> /*head*/) {
+                });
         }
-        return read_media(*m_store, m_keys.at(std::exchange(m_idx, m_idx + 1)));
+        lk.unlock();
+        return plai::media::Media(std::make_shared<StoredMedia>(reader.get()));
+    }
+
+ private:
+    std::optional<size_t> next_idx() const {
+        if (m_keys.empty()) return std::nullopt;
+        if (m_idx < m_keys.size()) return m_idx;
+        if (!m_repeat) return std::nullopt;
+        return 0;
     }
 };
 
@@ -81,8 +123,15 @@ int run(const Cli& args) {
     });
     plai::logs::init(args.log_level, args.log_file);
 
-    auto store = plai::sqlite_store(args.db);
-    auto playlist = Playlist(store.get());
+    const auto store_opts =
+        plai::SqliteOpts{.rebuild_for_compaction = args.rebuild_db};
+    auto store = args.media_dir.empty()
+                     ? plai::sqlite_store(args.db, store_opts)
+                     : plai::fs_store(args.media_dir, store_opts);
+    // store reads are done ahead of playback on a separate thread
+    auto io_pool = boost::asio::thread_pool(1);
+    auto async_store = plai::AsyncStore(*store, io_pool.get_executor());
+    auto playlist = Playlist(&async_store);
     auto ftype = args.void_frontend ? plai::FrontendType::Void
                                     : plai::FrontendType::Sdl2;
     auto frontend = plai::frontend(ftype);
@@ -102,6 +151,13 @@ int run(const Cli& args) {
     }
     auto player =
         plai::play::Player(frontend.get(), &playlist, std::move(opts));
+    // give space of removed media back while the player idles on an image
+    auto compactor = plai::StoreCompactor(
+        *store, io_pool.get_executor(), [&] { return player.showing_image(); });
+    auto stop_io = plai::Defer([&] {
+        io_pool.stop();
+        io_pool.join();
+    });
     auto api = ApiImpl(store.get(), &playlist, &player);
     auto srv = plai::net::launch_api(&api, args.socket);
     auto srv_thread = std::jthread([&] { srv->run(); });
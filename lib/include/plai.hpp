@@ -1,7 +1,9 @@
 #pragma once
 
+#include <plai/async_store.hpp>
 #include <plai/format.hpp>
 #include <plai/media/util.hpp>
 #include <plai/net/api.hpp>
 #include <plai/os/signal.hpp>
 #include <plai/play/player.hpp>
+#include <plai/store_compactor.hpp>
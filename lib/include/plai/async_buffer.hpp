@@ -0,0 +1,124 @@
+/**
+ * \brief Operations on buffers suspending the caller instead of the thread
+ *
+ * Each operation waits until the buffer has space or data and completes an
+ * asio completion token, e.g. a callback, boost::asio::use_future,
+ * boost::asio::use_awaitable or sched::use_co. The handler runs on its
+ * associated executor, asio's system executor for plain callbacks. Pending
+ * operations count as work of that executor. The buffer must outlive them.
+ * */
+#pragma once
+
+#include <boost/asio.hpp>
+#include <concepts>
+#include <optional>
+#include <plai/persist_buffer.hpp>
+#include <plai/ring_buffer.hpp>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace plai {
+namespace async_detail {
+
+template <class Handler, class Res>
+void complete(Handler& handler, Res&& res) {
+    if constexpr (std::same_as<std::remove_cvref_t<Res>, std::monostate>) {
+        std::move(handler)();
+    } else {
+        std::move(handler)(std::forward<Res>(res));
+    }
+}
+
+/**
+ * \brief Run `try_op` until it succeeds, calling `wait` with a retry each
+ * time it fails, and complete `handler` with its result
+ * */
+template <class Handler, class Work, class Try, class Wait>
+void retry(Handler handler, Work work, Try try_op, Wait wait) {
+    if (auto res = try_op()) {
+        boost::asio::post(work, [handler = std::move(handler),
+                                 res = std::move(*res)]() mutable {
+            complete(handler, std::move(res));
+        });
+        return;
+    }
+    wait([handler = std::move(handler), work = std::move(work),
+          try_op = std::move(try_op), wait]() mutable {
+        retry(std::move(handler), std::move(work), std::move(try_op),
+              std::move(wait));
+    });
+}
+
+template <class Sig, class Token, class Try, class Wait>
+auto initiate(Token&& token, Try try_op, Wait wait) {
+    return boost::asio::async_initiate<Token, Sig>(
+        [](auto handler, Try try_op, Wait wait) {
+            auto work = boost::asio::prefer(
+                boost::asio::get_associated_executor(handler),
+                boost::asio::execution::outstanding_work.tracked);
+            retry(std::move(handler), std::move(work), std::move(try_op),
+                  std::move(wait));
+        },
+        token, std::move(try_op), std::move(wait));
+}
+
+}  // namespace async_detail
+
+/**
+ * \brief Push `val` once `buf` has space, completes with `void()`
+ * */
+template <class T, class Token>
+auto async_push(RingBuffer<T>& buf, std::type_identity_t<T> val,
+                Token&& token) {
+    return async_detail::initiate<void()>(
+        std::forward<Token>(token),
+        [&buf, val = std::move(val)]() mutable
+            -> std::optional<std::monostate> {
+            if (!buf.try_emplace(std::move(val))) return std::nullopt;
+            return std::monostate{};
+        },
+        [&buf](auto retry) { buf.when_space(std::move(retry)); });
+}
+
+/**
+ * \brief Pop a value once `buf` has one, completes with `void(T)`
+ * */
+template <class T, class Token>
+auto async_pop(RingBuffer<T>& buf, Token&& token) {
+    return async_detail::initiate<void(T)>(
+        std::forward<Token>(token), [&buf] { return buf.try_pop(); },
+        [&buf](auto retry) { buf.when_data(std::move(retry)); });
+}
+
+/**
+ * \brief PersistBuffer::push() once `buf` has space, completes with
+ * `void(T)` and the replaced value
+ * */
+template <class T, class Token>
+auto async_push(PersistBuffer<T>& buf, std::type_identity_t<T> replace,
+                Token&& token) {
+    return async_detail::initiate<void(T)>(
+        std::forward<Token>(token),
+        [&buf, replace = std::move(replace)]() mutable {
+            return buf.try_push(std::move(replace));
+        },
+        [&buf](auto retry) { buf.when_space(std::move(retry)); });
+}
+
+/**
+ * \brief PersistBuffer::pop() once `buf` has a value, completes with
+ * `void(T)`
+ * */
+template <class T, class Token>
+auto async_pop(PersistBuffer<T>& buf, std::type_identity_t<T> replace,
+               Token&& token) {
+    return async_detail::initiate<void(T)>(
+        std::forward<Token>(token),
+        [&buf, replace = std::move(replace)]() mutable {
+            return buf.try_pop(std::move(replace));
+        },
+        [&buf](auto retry) { buf.when_data(std::move(retry)); });
+}
+
+}  // namespace plai
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <plai/sched/executor.hpp>
+#include <plai/store.hpp>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace plai {
+
+/**
+ * \brief Runs operations of a Store on an executor
+ *
+ * Each operation is posted to the executor given on construction, usually a
+ * thread pool reserved for I/O, so the caller is not blocked while the
+ * store is busy. The result is delivered to an asio completion token with
+ * the signature `void(std::exception_ptr, T)`, or `void(std::exception_ptr)`
+ * for operations without result. Passing boost::asio::use_future or
+ * boost::asio::use_awaitable turns errors into exceptions again.
+ *
+ * Handlers run on their associated executor, defaulting to the one of the
+ * store. The Store must outlive all operations in flight.
+ * */
+class AsyncStore {
+ public:
+    AsyncStore(Store& store, sched::Executor exec) noexcept
+        : m_store(&store), m_exec(std::move(exec)) {}
+
+    const sched::Executor& get_executor() const noexcept { return m_exec; }
+
+    /**
+     * \brief Read a blob, see Store::read()
+     * */
+    template <class Token>
+    auto async_read(std::string key, Token&& token) {
+        return run<std::vector<uint8_t>>(
+            [key = std::move(key)](Store& s) { return s.read(key); },
+            std::forward<Token>(token));
+    }
+
+    /**
+     * \brief Open a blob for ranged reads, see Store::reader()
+     * */
+    template <class Token>
+    auto async_reader(std::string key, Token&& token) {
+        return run<std::unique_ptr<StoreReader>>(
+            [key = std::move(key)](Store& s) { return s.reader(key); },
+            std::forward<Token>(token));
+    }
+
+    /**
+     * \brief Read part of a blob, see Store::read_range()
+     * */
+    template <class Token>
+    auto async_read_range(std::string key, size_t offset, size_t len,
+                          Token&& token) {
+        return run<std::vector<uint8_t>>(
+            [key = std::move(key), offset, len](Store& s) {
+                return s.read_range(key, offset, len);
+            },
+            std::forward<Token>(token));
+    }
+
+    /**
+     * \brief Store a blob, see Store::store()
+     * */
+    template <class Token>
+    auto async_store(std::string key, std::vector<uint8_t> blob,
+                     Token&& token) {
+        return run<void>(
+            [key = std::move(key), blob = std::move(blob)](Store& s) {
+                s.store(key, blob);
+            },
+            std::forward<Token>(token));
+    }
+
+    /**
+     * \brief Inspect a blob, see Store::inspect()
+     * */
+    template <class Token>
+    auto async_inspect(std::string key, Token&& token) {
+        return run<std::optional<BlobMeta>>(
+            [key = std::move(key)](Store& s) { return s.inspect(key); },
+            std::forward<Token>(token));
+    }
+
+ private:
+    template <class T>
+    struct SignatureOf {
+        using type = void(std::exception_ptr, T);
+    };
+
+    template <class T>
+    using Signature = typename SignatureOf<T>::type;
+
+    template <class T, class Fn, class Token>
+    auto run(Fn&& fn, Token&& token) {
+        auto init = [this](auto handler, auto fn) {
+            auto ex = boost::asio::get_associated_executor(handler, m_exec);
+            auto work = boost::asio::make_work_guard(ex);
+            boost::asio::post(m_exec, [store = m_store,
+                                       handler = std::move(handler),
+                                       fn = std::move(fn),
+                                       work = std::move(work)]() mutable {
+                auto ex = work.get_executor();
+                std::exception_ptr err{};
+                if constexpr (std::is_void_v<T>) {
+                    try {
+                        fn(*store);
+                    } catch (...) {
+                        err = std::current_exception();
+                    }
+                    boost::asio::dispatch(
+                        ex, [handler = std::move(handler), err]() mutable {
+                            std::move(handler)(err);
+                        });
+                } else {
+                    T res{};
+                    try {
+                        res = fn(*store);
+                    } catch (...) {
+                        err = std::current_exception();
+                    }
+                    boost::asio::dispatch(
+                        ex, [handler = std::move(handler), err,
+                             res = std::move(res)]() mutable {
+                            std::move(handler)(err, std::move(res));
+                        });
+                }
+                work.reset();
+            });
+        };
+        return boost::asio::async_initiate<Token, Signature<T>>(
+            std::move(init), token, std::forward<Fn>(fn));
+    }
+
+    Store* m_store;
+    sched::Executor m_exec;
+};
+
+template <>
+struct AsyncStore::SignatureOf<void> {
+    using type = void(std::exception_ptr);
+};
+
+}  // namespace plai
@@ -2,10 +2,16 @@
 
 #include <array>
 #include <cstdint>
+#include <memory>
+#include <optional>
 #include <span>
 #include <string>
 #include <string_view>
 
+extern "C" {
+struct evp_md_ctx_st;
+}
+
 namespace plai::crypto {
 
 constexpr uint8_t SHA256_LEN = 32;
@@ -17,4 +23,85 @@ Sha256 sha256(std::string_view data);
 
 std::string hex_str(Sha256View data);
 
+/**
+ * \brief Parse a digest from a hex string
+ *
+ * Inverse of hex_str(). Accepts both upper and lower case characters.
+ *
+ * \return Parsed digest or std::nullopt if the string is not a valid digest
+ * */
+std::optional<Sha256> parse_sha256(std::string_view hex);
+
+/**
+ * \brief Incremental SHA256 calculation
+ *
+ * Used for hashing data that is received in chunks, e.g. uploads, so the full
+ * data never needs to be in memory at once.
+ * */
+class Sha256Hasher {
+ public:
+    Sha256Hasher();
+
+    Sha256Hasher(const Sha256Hasher&) = delete;
+    Sha256Hasher& operator=(const Sha256Hasher&) = delete;
+
+    Sha256Hasher(Sha256Hasher&& other) noexcept;
+    Sha256Hasher& operator=(Sha256Hasher&& other) noexcept;
+
+    ~Sha256Hasher();
+
+    /**
+     * \brief Hash the next chunk of data
+     * */
+    void update(std::span<const uint8_t> data);
+
+    /**
+     * \brief Get the digest of all data passed to update()
+     *
+     * The hasher is reset afterwards and can be reused.
+     * */
+    Sha256 finish();
+
+ private:
+    evp_md_ctx_st* m_ctx;
+};
+
+/**
+ * \brief Sha256Hasher running on a dedicated thread
+ *
+ * update() copies the data to a small queue and returns right away so the
+ * caller can e.g. keep reading the next chunk from a socket while the
+ * previous ones are being hashed.
+ * */
+class BackgroundSha256Hasher {
+ public:
+    BackgroundSha256Hasher();
+
+    BackgroundSha256Hasher(const BackgroundSha256Hasher&) = delete;
+    BackgroundSha256Hasher& operator=(const BackgroundSha256Hasher&) = delete;
+
+    BackgroundSha256Hasher(BackgroundSha256Hasher&&) noexcept;
+    BackgroundSha256Hasher& operator=(BackgroundSha256Hasher&&) noexcept;
+
+    ~BackgroundSha256Hasher();
+
+    /**
+     * \brief Queue the next chunk of data for hashing
+     *
+     * Blocks only if the hashing thread has fallen behind.
+     * */
+    void update(std::span<const uint8_t> data);
+
+    /**
+     * \brief Wait for the queued data to be hashed and get the digest
+     *
+     * Unlike with Sha256Hasher this can be called only once.
+     * */
+    Sha256 finish();
+
+ private:
+    class Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
 }  // namespace plai::crypto
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <atomic>
+#include <cassert>
+#include <deque>
 #include <plai/flow/sink.hpp>
 #include <plai/flow/src.hpp>
 #include <utility>
@@ -31,25 +34,23 @@ class Connector final : SrcSubscriber, SinkSubscriber {
     void bootstrap() {
         m_src->set_subscriber(this);
         m_sink->set_subscriber(this);
-        sched::post(m_exec, [&] {
-            if (m_src->src_ready() && m_sink->sink_ready())
-                m_sink->consume(m_src->produce());
-        });
+        sched::post(m_exec, [this] { transfer(); });
     }
 
  private:
     void src_ready() override {
-        sched::post(m_exec, [&] {
-            if (!m_sink->sink_ready()) return;
-            m_sink->consume(m_src->produce());
-        });
+        sched::post(m_exec, [this] { transfer(); });
     }
 
     void sink_ready() override {
-        sched::post(m_exec, [&] {
-            if (!m_src->src_ready()) return;
+        sched::post(m_exec, [this] { transfer(); });
+    }
+
+    // both sides are checked since an earlier wakeup may already have taken
+    // the item a notification was about
+    void transfer() {
+        if (m_src->src_ready() && m_sink->sink_ready())
             m_sink->consume(m_src->produce());
-        });
     }
 
     sched::Executor m_exec{};
@@ -57,4 +58,119 @@ class Connector final : SrcSubscriber, SinkSubscriber {
     Sink<O>* m_sink;
 };
 
+struct BufferOpts {
+    /// Items held between the source and the sink at most
+    size_t capacity{8};
+
+    /// Items passed to the sink per wakeup at most, before yielding to other
+    /// handlers on the executor
+    size_t batch{32};
+};
+
+/**
+ * \brief Connector with a bounded queue between the source and the sink
+ *
+ * Items are pulled from the source as long as the queue has room, which is
+ * the credit the source gets, and passed on while the sink is ready. A
+ * notification only posts a wakeup if none is pending, and a wakeup moves up
+ * to BufferOpts::batch items, so a burst costs one post instead of one per
+ * item and notification. Only one wakeup runs at a time, even on an executor
+ * with several threads.
+ * */
+template <class I, class O>
+class BufferedConnector final : SrcSubscriber, SinkSubscriber {
+ public:
+    BufferedConnector(sched::Executor exec, Src<I>& src, Sink<O>& sink,
+                      BufferOpts opts) noexcept
+        : m_exec(std::move(exec)), m_src(&src), m_sink(&sink), m_opts(opts) {
+        assert(m_opts.capacity > 0 && m_opts.batch > 0);
+    }
+
+    BufferedConnector(const BufferedConnector&) = delete;
+    BufferedConnector& operator=(const BufferedConnector&) = delete;
+
+    /**
+     * \brief Only valid before bootstrap()
+     * */
+    BufferedConnector(BufferedConnector&& other) noexcept
+        : m_exec(std::move(other.m_exec)),
+          m_src(std::exchange(other.m_src, nullptr)),
+          m_sink(std::exchange(other.m_sink, nullptr)),
+          m_opts(other.m_opts),
+          m_queue(std::move(other.m_queue)) {}
+
+    BufferedConnector& operator=(BufferedConnector&&) = delete;
+
+    ~BufferedConnector() override {
+        if (m_src) {
+            m_src->set_subscriber(nullptr);
+            m_sink->set_subscriber(nullptr);
+        }
+    }
+
+    void bootstrap() {
+        m_src->set_subscriber(this);
+        m_sink->set_subscriber(this);
+        schedule();
+    }
+
+ private:
+    void src_ready() override { schedule(); }
+
+    void sink_ready() override { schedule(); }
+
+    void schedule() {
+        if (m_pending.fetch_add(1, std::memory_order_acq_rel) == 0) {
+            sched::post(m_exec, [this] { drain(); });
+        }
+    }
+
+    void drain() {
+        auto seen = m_pending.load(std::memory_order_acquire);
+        while (true) {
+            if (transfer()) {
+                // m_pending stays set, so no other wakeup is posted meanwhile
+                sched::post(m_exec, [this] { drain(); });
+                return;
+            }
+            // done unless notified while transferring
+            if (m_pending.fetch_sub(seen, std::memory_order_acq_rel) == seen) {
+                return;
+            }
+            seen = m_pending.load(std::memory_order_acquire);
+        }
+    }
+
+    /**
+     * \brief Move items until stuck or the batch is used up
+     *
+     * \return Whether the batch was used up
+     * */
+    bool transfer() {
+        size_t moved = 0;
+        bool progress = true;
+        while (progress) {
+            progress = false;
+            while (m_queue.size() < m_opts.capacity && m_src->src_ready()) {
+                m_queue.push_back(m_src->produce());
+                progress = true;
+            }
+            while (!m_queue.empty() && m_sink->sink_ready()) {
+                m_sink->consume(std::move(m_queue.front()));
+                m_queue.pop_front();
+                progress = true;
+                if (++moved == m_opts.batch) return true;
+            }
+        }
+        return false;
+    }
+
+    sched::Executor m_exec{};
+    Src<I>* m_src;
+    Sink<O>* m_sink;
+    BufferOpts m_opts;
+    std::deque<I> m_queue{};
+    std::atomic<size_t> m_pending{0};
+};
+
 }  // namespace plai::flow
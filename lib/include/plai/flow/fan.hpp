@@ -0,0 +1,186 @@
+#pragma once
+
+#include <cassert>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <plai/flow/sink.hpp>
+#include <plai/flow/src.hpp>
+#include <vector>
+
+namespace plai::flow {
+
+/**
+ * \brief Sink distributing items over several outputs in turn
+ *
+ * Item `k` goes to output `k % size()`. Each output holds one item, and the
+ * sink is only ready when the output whose turn it is has been emptied, so
+ * the order in which the outputs receive items never depends on timing.
+ * */
+template <class T>
+class RoundRobin final : public Sink<T> {
+ public:
+    class Output final : public Src<T> {
+     public:
+        explicit Output(RoundRobin* parent, size_t idx) noexcept
+            : m_parent(parent), m_idx(idx) {}
+
+        T produce() override { return m_parent->take(m_idx); }
+
+        bool src_ready() override {
+            auto lk = std::lock_guard(m_parent->m_mut);
+            return m_item.has_value();
+        }
+
+     private:
+        friend class RoundRobin;
+
+        RoundRobin* m_parent;
+        size_t m_idx;
+        std::optional<T> m_item{};
+    };
+
+    explicit RoundRobin(size_t n) {
+        assert(n > 0);
+        m_outputs.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            m_outputs.push_back(std::make_unique<Output>(this, i));
+        }
+    }
+
+    RoundRobin(const RoundRobin&) = delete;
+    RoundRobin& operator=(const RoundRobin&) = delete;
+
+    Src<T>& output(size_t idx) noexcept { return *m_outputs.at(idx); }
+
+    size_t size() const noexcept { return m_outputs.size(); }
+
+    void consume(T val) override {
+        Output* out{};
+        bool ready{};
+        {
+            auto lk = std::lock_guard(m_mut);
+            out = m_outputs[m_next].get();
+            assert(!out->m_item);
+            out->m_item = std::move(val);
+            m_next = (m_next + 1) % m_outputs.size();
+            ready = !m_outputs[m_next]->m_item;
+        }
+        out->notify_src_ready();
+        if (ready) this->notify_sink_ready();
+    }
+
+    bool sink_ready() override {
+        auto lk = std::lock_guard(m_mut);
+        return !m_outputs[m_next]->m_item;
+    }
+
+ private:
+    T take(size_t idx) {
+        bool turn{};
+        std::optional<T> item{};
+        {
+            auto lk = std::lock_guard(m_mut);
+            item = std::exchange(m_outputs[idx]->m_item, std::nullopt);
+            turn = idx == m_next;
+        }
+        assert(item);
+        if (turn) this->notify_sink_ready();
+        return std::move(*item);
+    }
+
+    std::mutex m_mut{};
+    size_t m_next{0};
+    std::vector<std::unique_ptr<Output>> m_outputs{};
+};
+
+/**
+ * \brief Source merging several inputs back into the order of a RoundRobin
+ *
+ * Without `ends_group` one item is taken from each input in turn, which
+ * restores the order for stages producing one item per consumed one. Stages
+ * producing several items per consumed one, like the decoder with its
+ * DecodingMeta, frames and EndOfMedia, pass a predicate recognizing the last
+ * item of each group. Items are then taken from input 0 until its group
+ * ends, then from input 1 and so on.
+ * */
+template <class T>
+class OrderedMerge final : public Src<T> {
+ public:
+    using GroupPred = std::function<bool(const T&)>;
+
+    class Input final : public Sink<T> {
+     public:
+        explicit Input(OrderedMerge* parent) noexcept : m_parent(parent) {}
+
+        void consume(T val) override {
+            {
+                auto lk = std::lock_guard(m_parent->m_mut);
+                assert(!m_item);
+                m_item = std::move(val);
+            }
+            m_parent->notify_src_ready();
+        }
+
+        bool sink_ready() override {
+            auto lk = std::lock_guard(m_parent->m_mut);
+            return !m_item.has_value();
+        }
+
+     private:
+        friend class OrderedMerge;
+
+        OrderedMerge* m_parent;
+        std::optional<T> m_item{};
+    };
+
+    explicit OrderedMerge(size_t n, GroupPred ends_group = {})
+        : m_ends_group(std::move(ends_group)) {
+        assert(n > 0);
+        m_inputs.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            m_inputs.push_back(std::make_unique<Input>(this));
+        }
+    }
+
+    OrderedMerge(const OrderedMerge&) = delete;
+    OrderedMerge& operator=(const OrderedMerge&) = delete;
+
+    Sink<T>& input(size_t idx) noexcept { return *m_inputs.at(idx); }
+
+    size_t size() const noexcept { return m_inputs.size(); }
+
+    T produce() override {
+        Input* in{};
+        std::optional<T> item{};
+        bool next_ready{};
+        {
+            auto lk = std::lock_guard(m_mut);
+            in = m_inputs[m_cur].get();
+            assert(in->m_item);
+            item = std::exchange(in->m_item, std::nullopt);
+            if (!m_ends_group || m_ends_group(*item)) {
+                m_cur = (m_cur + 1) % m_inputs.size();
+                next_ready = m_inputs[m_cur]->m_item.has_value();
+            }
+        }
+        in->notify_sink_ready();
+        // the next input was notified about its item while not current
+        if (next_ready) this->notify_src_ready();
+        return std::move(*item);
+    }
+
+    bool src_ready() override {
+        auto lk = std::lock_guard(m_mut);
+        return m_inputs[m_cur]->m_item.has_value();
+    }
+
+ private:
+    std::mutex m_mut{};
+    GroupPred m_ends_group;
+    size_t m_cur{0};
+    std::vector<std::unique_ptr<Input>> m_inputs{};
+};
+
+}  // namespace plai::flow
@@ -2,36 +2,252 @@
 
 #include <memory>
 #include <plai/flow/connector.hpp>
+#include <plai/flow/fan.hpp>
 #include <plai/flow/pipeline.hpp>
 #include <plai/flow/sink.hpp>
 #include <plai/flow/src.hpp>
+#include <span>
+#include <vector>
 
 namespace plai::flow {
 namespace detail {
 struct PipelineFinish {};
 
+struct Buffered {
+    BufferOpts opts;
+};
+
+struct On {
+    sched::Executor exec;
+};
+
+template <class Stage>
+struct FanOut {
+    std::vector<Stage*> stages;
+};
+
+template <class Pred>
+struct FanIn {
+    Pred ends_group;
+};
+
+struct FanInEach {};
+
+template <class T, class... Connectors>
+class SpecBuilder;
+
+/**
+ * \brief Connectors of a fan-out/fan-in section of a pipeline
+ *
+ * Owns the RoundRobin and the OrderedMerge, which outlive the connectors
+ * attached to them.
+ * */
+template <class I, class O>
+class FanConnectors {
+ public:
+    FanConnectors(std::unique_ptr<RoundRobin<I>> fan_out,
+                  std::unique_ptr<OrderedMerge<O>> fan_in,
+                  std::vector<Connector<I, I>> in,
+                  std::vector<Connector<O, O>> out) noexcept
+        : m_fan_out(std::move(fan_out)),
+          m_fan_in(std::move(fan_in)),
+          m_in(std::move(in)),
+          m_out(std::move(out)) {}
+
+    void bootstrap() {
+        for (auto& conn : m_in) conn.bootstrap();
+        for (auto& conn : m_out) conn.bootstrap();
+    }
+
+ private:
+    std::unique_ptr<RoundRobin<I>> m_fan_out;
+    std::unique_ptr<OrderedMerge<O>> m_fan_in;
+    std::vector<Connector<I, I>> m_in;
+    std::vector<Connector<O, O>> m_out;
+};
+
+/**
+ * \brief SpecBuilder after flow::fan_in() waiting for the merged sink
+ * */
+template <class T, class O, class... Connectors>
+class FanInSpec {
+ public:
+    FanInSpec(SpecBuilder<T, Connectors...> spec,
+              std::unique_ptr<RoundRobin<T>> fan_out,
+              std::unique_ptr<OrderedMerge<O>> fan_in,
+              std::vector<Connector<T, T>> in,
+              std::vector<Connector<O, O>> out) noexcept
+        : m_spec(std::move(spec)),
+          m_fan_out(std::move(fan_out)),
+          m_fan_in(std::move(fan_in)),
+          m_in(std::move(in)),
+          m_out(std::move(out)) {}
+
+    template <std::derived_from<Sink<O>> Snk>
+    auto operator|(Snk& sink) && {
+        m_out.emplace_back(m_spec.connector_exec(), *m_fan_in, sink);
+        return std::move(m_spec).connect(
+            sink, FanConnectors<T, O>(std::move(m_fan_out), std::move(m_fan_in),
+                                      std::move(m_in), std::move(m_out)));
+    }
+
+    FanInSpec operator|(On on) && {
+        return {std::move(m_spec) | std::move(on), std::move(m_fan_out),
+                std::move(m_fan_in), std::move(m_in), std::move(m_out)};
+    }
+
+ private:
+    SpecBuilder<T, Connectors...> m_spec;
+    std::unique_ptr<RoundRobin<T>> m_fan_out;
+    std::unique_ptr<OrderedMerge<O>> m_fan_in;
+    std::vector<Connector<T, T>> m_in;
+    std::vector<Connector<O, O>> m_out;
+};
+
+/**
+ * \brief SpecBuilder after flow::fan_out() waiting for flow::fan_in()
+ * */
+template <class T, class Stage, class... Connectors>
+class FanOutSpec {
+ public:
+    using O = typename Stage::produced_type;
+
+    FanOutSpec(SpecBuilder<T, Connectors...> spec,
+               std::vector<Stage*> stages) noexcept
+        : m_spec(std::move(spec)), m_stages(std::move(stages)) {}
+
+    FanInSpec<T, O, Connectors...> operator|(FanInEach) && {
+        return std::move(*this).merge({});
+    }
+
+    template <std::predicate<const O&> Pred>
+    FanInSpec<T, O, Connectors...> operator|(FanIn<Pred> fan_in) && {
+        return std::move(*this).merge(std::move(fan_in.ends_group));
+    }
+
+ private:
+    FanInSpec<T, O, Connectors...> merge(
+        typename OrderedMerge<O>::GroupPred ends_group) && {
+        auto n = m_stages.size();
+        auto rr = std::make_unique<RoundRobin<T>>(n);
+        auto merge =
+            std::make_unique<OrderedMerge<O>>(n, std::move(ends_group));
+        std::vector<Connector<T, T>> in{};
+        in.reserve(n + 1);
+        in.emplace_back(m_spec.connector_exec(), *m_spec.m_src, *rr);
+        std::vector<Connector<O, O>> out{};
+        out.reserve(n + 1);
+        for (size_t i = 0; i < n; ++i) {
+            in.emplace_back(m_spec.connector_exec(), rr->output(i),
+                            *m_stages[i]);
+            out.emplace_back(m_spec.connector_exec(), *m_stages[i],
+                             merge->input(i));
+        }
+        return {std::move(m_spec), std::move(rr), std::move(merge),
+                std::move(in), std::move(out)};
+    }
+
+    SpecBuilder<T, Connectors...> m_spec;
+    std::vector<Stage*> m_stages;
+};
+
+/**
+ * \brief SpecBuilder waiting for the sink to connect via a BufferedConnector
+ * */
+template <class T, class... Connectors>
+class BufferedSpec {
+ public:
+    BufferedSpec(SpecBuilder<T, Connectors...> spec, BufferOpts opts) noexcept
+        : m_spec(std::move(spec)), m_opts(opts) {}
+
+    template <std::derived_from<Sink<T>> Snk>
+    auto operator|(Snk& sink) && {
+        return std::move(m_spec).connect(
+            sink, BufferedConnector<T, T>(m_spec.connector_exec(),
+                                          *m_spec.m_src, sink, m_opts));
+    }
+
+    BufferedSpec operator|(On on) && {
+        return {std::move(m_spec) | std::move(on), m_opts};
+    }
+
+ private:
+    SpecBuilder<T, Connectors...> m_spec;
+    BufferOpts m_opts;
+};
+
 template <class T, class... Connectors>
 class SpecBuilder {
  public:
     explicit constexpr SpecBuilder(sched::Executor exec, Src<T>& src) noexcept
         : m_exec(std::move(exec)), m_src(&src) {}
     explicit constexpr SpecBuilder(
-        sched::Executor exec, Src<T>& src,
+        sched::Executor exec, bool strands, Src<T>& src,
         std::tuple<Connectors...> connectors) noexcept
         : m_exec(std::move(exec)),
+          m_strands(strands),
           m_src(&src),
           m_connectors(std::move(connectors)) {}
 
     template <std::derived_from<Sink<T>> Snk>
     auto operator|(Snk& sink) && {
-        using NewConnector = Connector<T, T>;
+        return std::move(*this).connect(
+            sink, Connector<T, T>(connector_exec(), *m_src, sink));
+    }
+
+    /**
+     * \brief Connect the next sink via a BufferedConnector
+     * */
+    BufferedSpec<T, Connectors...> operator|(Buffered buffered) && {
+        return {std::move(*this), buffered.opts};
+    }
+
+    /**
+     * \brief Spread items over several stages, see flow::fan_out()
+     * */
+    template <std::derived_from<Sink<T>> Stage>
+        requires src_type<Stage>
+    FanOutSpec<T, Stage, Connectors...> operator|(FanOut<Stage> fan_out) && {
+        return {std::move(*this), std::move(fan_out.stages)};
+    }
+
+    /**
+     * \brief Run the following connectors on another executor
+     * */
+    SpecBuilder operator|(On on) && {
+        assert(on.exec);
+        m_exec = std::move(on.exec);
+        m_strands = true;
+        return std::move(*this);
+    }
+
+ private:
+    friend class BufferedSpec<T, Connectors...>;
+    template <class, class, class...>
+    friend class FanOutSpec;
+    template <class, class, class...>
+    friend class FanInSpec;
+
+    /**
+     * \brief Executor for the next connector
+     *
+     * Each connector after flow::on() gets a strand of its own, so its
+     * handlers do not run concurrently on a thread pool while different
+     * connectors still do.
+     * */
+    sched::Executor connector_exec() const {
         assert(m_exec);
-        auto new_connectors =
-            std::tuple_cat(std::move(m_connectors),
-                           std::make_tuple(NewConnector(m_exec, *m_src, sink)));
+        if (!m_strands) return m_exec;
+        return boost::asio::make_strand(m_exec);
+    }
+
+    template <class Snk, class NewConnector>
+    auto connect(Snk& sink, NewConnector connector) && {
+        auto new_connectors = std::tuple_cat(
+            std::move(m_connectors), std::make_tuple(std::move(connector)));
         if constexpr (src_type<std::remove_cvref_t<Snk>>) {
             return SpecBuilder<typename Snk::produced_type, Connectors...,
-                               NewConnector>(m_exec, sink,
+                               NewConnector>(m_exec, m_strands, sink,
                                              std::move(new_connectors));
         } else {
             return SpecBuilder<void, Connectors..., NewConnector>(
@@ -39,8 +255,8 @@ class SpecBuilder {
         }
     }
 
- private:
     sched::Executor m_exec;
+    bool m_strands{false};
     Src<T>* m_src;
     std::tuple<Connectors...> m_connectors{};
 };
@@ -92,4 +308,73 @@ constexpr detail::PipelineStart pipeline(T& t) {
 
 constexpr detail::PipelineFinish pipeline_finish() noexcept { return {}; }
 
+/**
+ * \brief Run the connectors that follow on `exec`
+ *
+ * A connector calls produce() of its source and consume() of its sink on its
+ * executor, e.g. in
+ *
+ *     flow::pipeline(exec) | src | flow::on(decode_pool) | decoder |
+ *         flow::on(render_exec) | player
+ *
+ * the decoder consumes on `decode_pool` and produces on `render_exec`. A stage
+ * whose two sides run on different executors has to be thread-safe. Each
+ * connector gets a strand of `exec`, so its own calls are never concurrent.
+ * */
+inline detail::On on(sched::Executor exec) { return {.exec = std::move(exec)}; }
+
+template <executor_provider T>
+detail::On on(T& t) {
+    return on(t.get_executor());
+}
+
+/**
+ * \brief Process items on several stages in parallel
+ *
+ * Items are handed to `stages` in turn and flow::fan_in() merges what the
+ * stages produce back into the original order, e.g.
+ *
+ *     flow::pipeline(exec) | src | flow::fan_out(dec1, dec2) |
+ *         flow::fan_in(mods::ends_media) | player
+ *
+ * lets each decoder work on another media while the player still receives
+ * them in playlist order. The stages must be of the same type and do their
+ * work on executors of their own to actually run in parallel.
+ * */
+template <class Stage, std::same_as<Stage>... Rest>
+detail::FanOut<Stage> fan_out(Stage& stage, Rest&... rest) {
+    return {.stages = {&stage, &rest...}};
+}
+
+template <class Stage>
+detail::FanOut<Stage> fan_out(std::span<Stage* const> stages) {
+    assert(!stages.empty());
+    return {.stages = {stages.begin(), stages.end()}};
+}
+
+/**
+ * \brief Merge the stages of flow::fan_out() back into order
+ *
+ * `ends_group` tells whether an item produced by a stage is the last one for
+ * its consumed item, see OrderedMerge.
+ * */
+template <class Pred>
+detail::FanIn<Pred> fan_in(Pred ends_group) {
+    return {.ends_group = std::move(ends_group)};
+}
+
+/**
+ * \brief Merge stages producing exactly one item per consumed one
+ * */
+constexpr detail::FanInEach fan_in() noexcept { return {}; }
+
+/**
+ * \brief Connect the following sink via a BufferedConnector
+ *
+ * E.g. `flow::pipeline(exec) | src | flow::buffered() | sink`.
+ * */
+constexpr detail::Buffered buffered(BufferOpts opts = {}) noexcept {
+    return {.opts = opts};
+}
+
 }  // namespace plai::flow
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <filesystem>
+#include <memory>
 #include <plai/media/forward.hpp>
+#include <plai/media/media.hpp>
 #include <plai/media/packet.hpp>
 #include <plai/media/stream_view_span.hpp>
 #include <vector>
@@ -25,6 +27,19 @@ class Demux {
      * */
     explicit Demux(std::span<const uint8_t> buf);
 
+    /**
+     * \brief Demultiplex a file read on demand from `src`
+     *
+     * Only the parts the demuxer asks for are read, e.g. when it seeks to an
+     * index at the end.
+     * */
+    explicit Demux(std::shared_ptr<ByteSource> src);
+
+    /**
+     * \brief Demultiplex a media from memory or its ByteSource
+     * */
+    explicit Demux(const Media& media);
+
     /**
      * \brief Create a demux targeting a file
      * */
@@ -56,19 +71,19 @@ class Demux {
 
  private:
     /**
-     * \brief Callback for FFmpeg when reading from in-memory buffer
+     * \brief Callback for FFmpeg when reading from m_src
      * */
     static int buffer_read(void* userdata, uint8_t* buf, int buflen) noexcept;
 
     /**
-     * \brief Callback for FFmpeg when reading from in-memory buffer
+     * \brief Callback for FFmpeg when seeking in m_src
      * */
     static int64_t buffer_seek(void* userdata, int64_t offset,
                                int whence) noexcept;
 
-    // only used if a buffer is passed via constructor
-    std::span<const uint8_t> m_buf{};
-    size_t m_buf_offset{};
+    // only used if a buffer or source is passed via constructor
+    std::shared_ptr<ByteSource> m_src{};
+    size_t m_offset{};
     AVFormatContext* m_ctx;
     AVIOContext* m_io_ctx{};
 };
@@ -1,12 +1,29 @@
 #pragma once
 #include <cstdint>
 #include <memory>
+#include <plai/virtual.hpp>
 #include <span>
 #include <variant>
 #include <vector>
 
 namespace plai::media {
 
+/**
+ * \brief Random access to media bytes that are not held in memory
+ * */
+class ByteSource : public Virtual {
+ public:
+    virtual size_t size() const noexcept = 0;
+
+    /**
+     * \brief Read from `offset` on
+     *
+     * \return Number of bytes read into `out`, fewer than requested only at
+     * the end
+     * */
+    virtual size_t read(size_t offset, std::span<uint8_t> out) = 0;
+};
+
 class Media {
  public:
     constexpr Media() noexcept = default;
@@ -14,16 +31,39 @@ class Media {
     explicit Media(std::vector<uint8_t> v)
         : m_dat(std::make_shared<std::vector<uint8_t>>(std::move(v))) {}
 
-    std::span<uint8_t> data() const noexcept { return *m_dat; }
+    /**
+     * \brief Media read on demand from `src`
+     * */
+    explicit Media(std::shared_ptr<ByteSource> src) noexcept
+        : m_src(std::move(src)) {}
 
-    std::vector<uint8_t> get_data() { return std::move(*m_dat); }
+    /**
+     * \brief Data held in memory, empty for media backed by a ByteSource
+     * */
+    std::span<uint8_t> data() const noexcept {
+        if (!m_dat) return {};
+        return *m_dat;
+    }
+
+    /**
+     * \brief Take the data held in memory, see data()
+     * */
+    std::vector<uint8_t> get_data() {
+        if (!m_dat) return {};
+        return std::move(*m_dat);
+    }
+
+    const std::shared_ptr<ByteSource>& source() const noexcept {
+        return m_src;
+    }
 
     constexpr explicit operator bool() const noexcept {
-        return static_cast<bool>(m_dat);
+        return static_cast<bool>(m_dat) || static_cast<bool>(m_src);
     }
 
  private:
     std::shared_ptr<std::vector<uint8_t>> m_dat{};
+    std::shared_ptr<ByteSource> m_src{};
 };
 
 }  // namespace plai::media
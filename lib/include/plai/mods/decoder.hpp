@@ -14,13 +14,27 @@ struct DecodingMeta {
     constexpr bool still() const noexcept { return fps.is_nan(); }
 };
 
-using Decoded = std::variant<DecodingMeta, media::Frame>;
+/**
+ * \brief Last item decoded from a media
+ * */
+struct EndOfMedia {};
+
+using Decoded = std::variant<DecodingMeta, media::Frame, EndOfMedia>;
+
+/**
+ * \brief Whether `item` is the last one decoded from a media
+ *
+ * Predicate for merging several decoders with flow::fan_in().
+ * */
+inline bool ends_media(const Decoded& item) noexcept {
+    return std::holds_alternative<EndOfMedia>(item);
+}
 
 /**
  * \brief Module for converting media blobs to streams of frames
  *
  * Stream for each meta starts with an instance of DeocingMeta followed by one
- * or more frames.
+ * or more frames and ends with EndOfMedia.
  * */
 class Decoder : public flow::Sink<media::Media>, public flow::Src<Decoded> {};
 
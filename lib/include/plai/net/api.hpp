@@ -49,7 +49,8 @@ struct MediaListEntry {
 /**
  * \brief API implementation
  *
- * Bunch of callbacks called by the API server.
+ * Bunch of callbacks called by the API server. The server calls them from
+ * several threads concurrently, so implementations have to be thread-safe.
  *
  * See doc/rest.md for API specification
  * */
@@ -62,9 +63,19 @@ class ApiV1 : public Virtual {
 
     /**
      * \brief Media upload
+     *
+     * \param type Media type
+     * \param key Media name
+     * \param size Size of the upload if known in advance
+     * \param digest Digest provided by the client. Implementations should
+     * throw DigestMismatch if the received data does not match it and may
+     * skip reading the body if data with this digest is already stored.
+     * \param body Returns the next chunk of the upload or std::nullopt at
+     * the end
      * */
     virtual void put_media(
-        MediaType type, std::string_view key,
+        MediaType type, std::string_view key, std::optional<size_t> size,
+        std::optional<crypto::Sha256> digest,
         std::function<std::optional<std::span<const uint8_t>>()> body) = 0;
 
     /**
@@ -100,8 +111,8 @@ class ApiV1 : public Virtual {
 /**
  * \brief API implementing the media storing
  *
- * This uses the given Store object to handle storage of the medias. The play()
- * method is left for the user.
+ * This uses the given Store object to handle storage of the medias, which has
+ * to be thread-safe. The play() method is left for the user.
  * */
 class DefaultApi : public ApiV1 {
  public:
@@ -110,7 +121,8 @@ class DefaultApi : public ApiV1 {
     MediaMeta get_media(MediaType type, std::string_view key) override;
 
     void put_media(
-        MediaType type, std::string_view key,
+        MediaType type, std::string_view key, std::optional<size_t> size,
+        std::optional<crypto::Sha256> digest,
         std::function<std::optional<std::span<const uint8_t>>()> body) override;
 
     DeleteResult delete_media(MediaType type, std::string_view key) override;
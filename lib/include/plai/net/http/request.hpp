@@ -17,6 +17,24 @@ class Request {
      * */
     virtual const QueryParams& query_params() const = 0;
 
+    /**
+     * \brief Size of the request body
+     *
+     * \return Value of Content-Length or std::nullopt if the header is not set,
+     * e.g. with chunked transfer encoding.
+     * */
+    virtual std::optional<size_t> content_length() const = 0;
+
+    /**
+     * \brief Value of a request header
+     *
+     * \param name Case-insensitive name of the header
+     *
+     * \return Header value or std::nullopt if the header is not set
+     * */
+    virtual std::optional<std::string_view> header(
+        std::string_view name) const = 0;
+
     // TODO: make not const
     virtual std::string_view text() const = 0;
     virtual std::optional<std::string_view> text_chunked() const = 0;
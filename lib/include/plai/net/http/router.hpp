@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <plai/net/http/method.hpp>
+#include <plai/net/http/target.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace plai::net::http {
+
+/**
+ * \brief Maps request targets to routes registered with patterns
+ *
+ * Patterns use the same syntax as parse_target(). They are split into
+ * segments once when added and stored in a trie, so matching a target walks
+ * it segment by segment and does not allocate. Literal segments take
+ * precedence over parameters.
+ * */
+class Router {
+ public:
+    using Route = size_t;
+
+    struct Match {
+        /**
+         * \brief Route for the requested method
+         *
+         * std::nullopt when the target matches a pattern, but only for other
+         * methods.
+         * */
+        std::optional<Route> route;
+        Target target;
+    };
+
+    /**
+     * \brief Register `route` for `pattern` and `methods`
+     *
+     * \throw ValueError on an invalid pattern or when a route is already
+     * registered for the same pattern and one of the methods
+     * */
+    void add(std::string_view pattern, Method methods, Route route);
+
+    /**
+     * \brief Find the route for a target
+     *
+     * \return std::nullopt when no pattern matches
+     * */
+    std::optional<Match> match(std::string_view target,
+                               Method method) const noexcept;
+
+ private:
+    using Index = uint32_t;
+    static constexpr Index NONE = ~Index{0};
+
+    struct Endpoint {
+        Method methods;
+        Route route;
+        // names of the parameter segments in order of appearance
+        std::vector<std::string> params;
+    };
+
+    struct Node {
+        // literal segments, there are few per node so they are scanned
+        // linearly
+        std::vector<std::pair<std::string, Index>> children{};
+        Index param_child{NONE};
+        std::vector<Endpoint> endpoints{};
+    };
+
+    using Values = std::array<std::string_view, PathParams::MAX_SIZE>;
+
+    struct Lookup;
+
+    bool match_node(Index node, std::string_view tgt, size_t pos,
+                    Values& values, size_t depth, Lookup& out) const noexcept;
+
+    std::vector<Node> m_nodes{1};
+};
+
+}  // namespace plai::net::http
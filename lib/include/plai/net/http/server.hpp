@@ -5,6 +5,7 @@
 #include <plai/net/http/method.hpp>
 #include <plai/net/http/request.hpp>
 #include <plai/net/http/response.hpp>
+#include <plai/time.hpp>
 
 namespace plai::net::http {
 
@@ -16,6 +17,9 @@ class ServerBuilder {
  public:
     using Self = ServerBuilder;
 
+    static constexpr size_t DEFAULT_THREADS = 4;
+    static constexpr Duration DEFAULT_IDLE_TIMEOUT = std::chrono::seconds(30);
+
     ServerBuilder();
 
     ~ServerBuilder();
@@ -27,6 +31,33 @@ class ServerBuilder {
 
     Self& bind(std::string socket);
 
+    /**
+     * \brief Number of worker threads serving requests
+     *
+     * Each request being handled occupies one worker until its handler
+     * returns, e.g. for the duration of an upload, so this bounds the number
+     * of requests served concurrently.
+     * */
+    Self& threads(size_t count);
+
+    /**
+     * \brief Let handlers run concurrently on the workers
+     *
+     * Off by default, so that handlers need not be thread-safe. Requests are
+     * still read and answered concurrently then, but only one handler runs
+     * at a time, and an upload holds up the other handlers until its body
+     * is read.
+     * */
+    Self& concurrent_handlers(bool val = true);
+
+    /**
+     * \brief How long a connection may go without progress
+     *
+     * Applies to waiting for the next request on a persistent connection,
+     * to each read of a request body and to writing the response.
+     * */
+    Self& idle_timeout(Duration timeout);
+
     Server commit();
 
  private:
@@ -48,6 +79,8 @@ class Server {
 
     /**
      * \brief Run synchronously
+     *
+     * The calling thread is used as one of the workers.
      * */
     void run();
 
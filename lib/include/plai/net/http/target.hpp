@@ -1,19 +1,77 @@
 #pragma once
 
+#include <array>
 #include <compare>
-#include <map>
 #include <plai/exceptions.hpp>
 #include <plai/format.hpp>
 #include <plai/util/view_generator.hpp>
+#include <span>
+#include <stdexcept>
 #include <string>
 #include <string_view>
 #include <vector>
 
 namespace plai::net::http {
 
+/**
+ * \brief Path parameters of a target stored inline
+ *
+ * Lookups are linear which is faster than a map for the handful of
+ * parameters a pattern has, and matching a target does not allocate.
+ * */
+class PathParams {
+ public:
+    static constexpr size_t MAX_SIZE = 8;
+    using value_type = std::pair<std::string_view, std::string_view>;
+    using const_iterator = const value_type*;
+
+    /**
+     * \brief Set parameter `name` to `value`, overwriting any previous value
+     *
+     * \throw ValueError when there are more than MAX_SIZE parameters
+     * */
+    void set(std::string_view name, std::string_view value) {
+        for (auto& p : std::span(m_pars.data(), m_size)) {
+            if (p.first == name) {
+                p.second = value;
+                return;
+            }
+        }
+        if (m_size == MAX_SIZE) throw ValueError("too many path parameters");
+        m_pars[m_size++] = {name, value};
+    }
+
+    /**
+     * \throw std::out_of_range when the parameter is not present
+     * */
+    std::string_view at(std::string_view name) const {
+        for (const auto& [n, v] : *this) {
+            if (n == name) return v;
+        }
+        throw std::out_of_range("no such path parameter");
+    }
+
+    bool contains(std::string_view name) const noexcept {
+        for (const auto& [n, _] : *this) {
+            if (n == name) return true;
+        }
+        return false;
+    }
+
+    size_t size() const noexcept { return m_size; }
+    bool empty() const noexcept { return m_size == 0; }
+
+    const_iterator begin() const noexcept { return m_pars.data(); }
+    const_iterator end() const noexcept { return m_pars.data() + m_size; }
+
+ private:
+    std::array<value_type, MAX_SIZE> m_pars{};
+    size_t m_size{};
+};
+
 class Target {
  public:
-    using Params = std::map<std::string_view, std::string_view, std::less<>>;
+    using Params = PathParams;
 
     Target() = default;
     Target(std::string_view target, Params params)
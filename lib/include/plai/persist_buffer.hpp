@@ -6,7 +6,9 @@
 #include <condition_variable>
 #include <cstddef>
 #include <mutex>
+#include <optional>
 #include <plai/util/tags.hpp>
+#include <plai/util/waiters.hpp>
 #include <utility>
 #include <vector>
 
@@ -52,8 +54,26 @@ class PersistBuffer {
         auto res = std::exchange(m_buf.at((m_offset + m_count) % m_buf.size()),
                                  std::move(replace));
         ++m_count;
+        auto waiter = m_data_waiters.take();
         lk.unlock();
         m_data.notify_one();
+        if (waiter) waiter();
+        return res;
+    }
+
+    /**
+     * \brief push() if the buffer is not full, `replace` is kept otherwise
+     * */
+    std::optional<T> try_push(T&& replace) {
+        auto lk = std::unique_lock(m_mut);
+        if (m_count == m_buf.size()) return std::nullopt;
+        auto res = std::exchange(m_buf.at((m_offset + m_count) % m_buf.size()),
+                                 std::move(replace));
+        ++m_count;
+        auto waiter = m_data_waiters.take();
+        lk.unlock();
+        m_data.notify_one();
+        if (waiter) waiter();
         return res;
     }
 
@@ -67,15 +87,69 @@ class PersistBuffer {
         auto res = std::exchange(m_buf.at(m_offset), std::move(replace));
         m_offset = (m_offset + 1) % m_buf.size();
         --m_count;
+        auto waiter = m_space_waiters.take();
+        lk.unlock();
+        m_space.notify_one();
+        if (waiter) waiter();
+        return res;
+    }
+
+    /**
+     * \brief pop() if the buffer has a value, `replace` is kept otherwise
+     * */
+    std::optional<T> try_pop(T&& replace) {
+        auto lk = std::unique_lock(m_mut);
+        if (m_count == 0) return std::nullopt;
+        auto res = std::exchange(m_buf.at(m_offset), std::move(replace));
+        m_offset = (m_offset + 1) % m_buf.size();
+        --m_count;
+        auto waiter = m_space_waiters.take();
         lk.unlock();
         m_space.notify_one();
+        if (waiter) waiter();
         return res;
     }
 
+    /**
+     * \brief Call `fn` once a value can be pushed
+     *
+     * Right away if it already can, otherwise from the thread making space.
+     * Another producer may fill the buffer again before `fn` runs, so it
+     * should use try_push() and wait again if that fails.
+     * */
+    template <class F>
+    void when_space(F&& fn) {
+        {
+            auto lk = std::lock_guard(m_mut);
+            if (m_count == m_buf.size()) {
+                m_space_waiters.add(std::forward<F>(fn));
+                return;
+            }
+        }
+        std::forward<F>(fn)();
+    }
+
+    /**
+     * \brief Call `fn` once a value can be popped, see when_space()
+     * */
+    template <class F>
+    void when_data(F&& fn) {
+        {
+            auto lk = std::lock_guard(m_mut);
+            if (m_count == 0) {
+                m_data_waiters.add(std::forward<F>(fn));
+                return;
+            }
+        }
+        std::forward<F>(fn)();
+    }
+
  private:
     mutable std::mutex m_mut{};
     std::condition_variable m_space{};
     std::condition_variable m_data{};
+    Waiters m_space_waiters{};
+    Waiters m_data_waiters{};
     std::vector<T> m_buf{};
     size_t m_offset{};
     size_t m_count{};
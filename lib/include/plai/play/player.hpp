@@ -90,6 +90,13 @@ class Player {
      * */
     void clear_media_queue();
 
+    /**
+     * \brief Whether a still image is being shown
+     *
+     * The player is mostly idle then. Can be called from any thread.
+     * */
+    bool showing_image() const noexcept;
+
  private:
     class Impl;
     std::unique_ptr<Impl> m_impl;
@@ -4,6 +4,7 @@
 #include <mutex>
 #include <optional>
 #include <plai/util/defer.hpp>
+#include <plai/util/waiters.hpp>
 #include <utility>
 
 namespace plai {
@@ -88,30 +89,35 @@ class RingBuffer {
 
     template <class... Ts>
     void emplace(Ts&&... ts) {
-        auto defer = Defer([&] { m_data.notify_one(); });
+        Waiter waiter{};
+        auto defer = Defer([&] { notify(m_data, waiter); });
         auto lk = std::unique_lock(m_mut);
         m_space.wait(lk, [&] { return m_ctx.count < m_ctx.capacity; });
         auto idx = (m_ctx.offset + m_ctx.count) % m_ctx.capacity;
         std::construct_at(&m_ctx.buf[idx].value, std::forward<Ts>(ts)...);
         ++m_ctx.count;
+        waiter = m_data_waiters.take();
     }
 
     template <class... Ts>
     bool try_emplace(Ts&&... ts) {
-        auto defer = Defer([&] { m_data.notify_one(); });
+        Waiter waiter{};
+        auto defer = Defer([&] { notify(m_data, waiter); });
         auto lk = std::unique_lock(m_mut);
         if (m_ctx.count == m_ctx.capacity) {
             defer.cancel();
             return false;
         }
-        auto idx = (m_ctx.offset + m_ctx.count) & m_ctx.capacity;
+        auto idx = (m_ctx.offset + m_ctx.count) % m_ctx.capacity;
         std::construct_at(&m_ctx.buf[idx].value, std::forward<Ts>(ts)...);
         ++m_ctx.count;
+        waiter = m_data_waiters.take();
         return true;
     }
 
     T pop() {
-        auto defer = Defer([&] { m_space.notify_one(); });
+        Waiter waiter{};
+        auto defer = Defer([&] { notify(m_space, waiter); });
         auto lk = std::unique_lock(m_mut);
         m_data.wait(lk, [&] { return m_ctx.count > 0; });
         auto offset = m_ctx.offset++;
@@ -119,11 +125,13 @@ class RingBuffer {
         m_ctx.offset %= m_ctx.capacity;
         auto res = std::move(m_ctx.buf[offset].value);
         m_ctx.buf[offset].value.~T();
+        waiter = m_space_waiters.take();
         return res;
     }
 
     std::optional<T> try_pop() {
-        auto defer = Defer([&] { m_space.notify_one(); });
+        Waiter waiter{};
+        auto defer = Defer([&] { notify(m_space, waiter); });
         auto lk = std::unique_lock(m_mut);
         if (m_ctx.count == 0) {
             defer.cancel();
@@ -134,13 +142,57 @@ class RingBuffer {
         m_ctx.offset %= m_ctx.capacity;
         auto res = std::move(m_ctx.buf[offset].value);
         m_ctx.buf[offset].value.~T();
+        waiter = m_space_waiters.take();
         return res;
     }
 
+    /**
+     * \brief Call `fn` once the buffer is not full
+     *
+     * Right away if it already is, otherwise from the thread making space.
+     * Another producer may fill the buffer again before `fn` runs, so it
+     * should use try_emplace() and wait again if that fails.
+     * */
+    template <class F>
+    void when_space(F&& fn) {
+        when(m_space_waiters, std::forward<F>(fn),
+             [&] { return m_ctx.count < m_ctx.capacity; });
+    }
+
+    /**
+     * \brief Call `fn` once the buffer is not empty, see when_space()
+     * */
+    template <class F>
+    void when_data(F&& fn) {
+        when(m_data_waiters, std::forward<F>(fn),
+             [&] { return m_ctx.count > 0; });
+    }
+
  private:
+    using Waiter = Waiters::Fn;
+
+    template <class F, class Pred>
+    void when(Waiters& waiters, F&& fn, Pred&& ready) {
+        {
+            auto lk = std::lock_guard(m_mut);
+            if (!ready()) {
+                waiters.add(std::forward<F>(fn));
+                return;
+            }
+        }
+        std::forward<F>(fn)();
+    }
+
+    static void notify(std::condition_variable& cv, Waiter& waiter) {
+        cv.notify_one();
+        if (waiter) waiter();
+    }
+
     mutable std::mutex m_mut{};
     std::condition_variable m_space{};
     std::condition_variable m_data{};
+    Waiters m_space_waiters{};
+    Waiters m_data_waiters{};
     buf_detail::Ctx<T> m_ctx{};
 };
 }  // namespace plai
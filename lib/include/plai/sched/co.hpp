@@ -0,0 +1,446 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <plai/ring_buffer.hpp>
+#include <plai/sched/detail/post_recurse.hpp>
+#include <plai/sched/executor.hpp>
+#include <plai/sched/post_chain.hpp>
+#include <plai/time.hpp>
+#include <tuple>
+#include <utility>
+
+namespace plai::sched {
+
+template <class T = void>
+class Co;
+
+namespace detail {
+/**
+ * \brief State shared by the coroutines of one spawn()
+ *
+ * The executor is type-erased, which drops an allocator, so resumptions use
+ * the thread-local handler recycling of asio.
+ * */
+struct CoRoot {
+    explicit CoRoot(const Executor& exec) : exec(prepare_post(exec)) {}
+
+    void switch_to(const Executor& other) { exec = prepare_post(other); }
+
+    template <class F>
+    void execute(F&& f) const {
+        boost::asio::execution::execute(exec, std::forward<F>(f));
+    }
+
+    Executor exec;
+};
+
+/// What the spawned coroutine that just finished on this thread threw
+inline thread_local std::exception_ptr co_error{};
+
+/**
+ * \brief Resume `h`, rethrowing what a spawned coroutine finished with
+ *
+ * All coroutines are resumed through this so errors leave the executor like
+ * those of a Task.
+ * */
+inline void resume(std::coroutine_handle<> h) {
+    h.resume();
+    if (co_error) std::rethrow_exception(std::exchange(co_error, nullptr));
+}
+
+/**
+ * \brief Resume `h` on the executor of its coroutine
+ * */
+template <class P>
+void resume_later(std::coroutine_handle<P> h) {
+    h.promise().co_root()->execute([h] { resume(h); });
+}
+
+class CoPromiseBase {
+ public:
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    auto final_suspend() noexcept {
+        struct Final {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(
+                std::coroutine_handle<>) noexcept {
+                return cont;
+            }
+            void await_resume() noexcept {}
+
+            std::coroutine_handle<> cont;
+        };
+        return Final{m_cont};
+    }
+
+    void unhandled_exception() noexcept { m_error = std::current_exception(); }
+
+    CoRoot* co_root() const noexcept { return m_root; }
+
+    void start(CoRoot* root, std::coroutine_handle<> cont) noexcept {
+        m_root = root;
+        m_cont = cont;
+    }
+
+ protected:
+    void rethrow() const {
+        if (m_error) std::rethrow_exception(m_error);
+    }
+
+ private:
+    CoRoot* m_root{};
+    std::coroutine_handle<> m_cont{};
+    std::exception_ptr m_error{};
+};
+
+template <class T>
+class CoPromise : public CoPromiseBase {
+ public:
+    Co<T> get_return_object() noexcept;
+
+    template <class U>
+    void return_value(U&& val) {
+        m_value.emplace(std::forward<U>(val));
+    }
+
+    T result() {
+        rethrow();
+        return std::move(*m_value);
+    }
+
+ private:
+    std::optional<T> m_value{};
+};
+
+template <>
+class CoPromise<void> : public CoPromiseBase {
+ public:
+    Co<void> get_return_object() noexcept;
+
+    void return_void() noexcept {}
+
+    void result() const { rethrow(); }
+};
+
+template <class T>
+struct CoAwaiter {
+    bool await_ready() noexcept { return false; }
+
+    template <class P>
+    std::coroutine_handle<> await_suspend(
+        std::coroutine_handle<P> parent) noexcept {
+        handle.promise().start(parent.promise().co_root(), parent);
+        return handle;
+    }
+
+    T await_resume() { return handle.promise().result(); }
+
+    std::coroutine_handle<CoPromise<T>> handle;
+};
+
+/**
+ * \brief Coroutine started by spawn(), owning its frame
+ * */
+struct Spawned {
+    struct promise_type {
+        template <class... Args>
+        explicit promise_type(const Executor& exec, Args&&...) : root(exec) {}
+
+        Spawned get_return_object() noexcept {
+            return {std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        auto final_suspend() noexcept {
+            struct Final {
+                bool await_ready() noexcept { return false; }
+                void await_suspend(
+                    std::coroutine_handle<promise_type> h) noexcept {
+                    co_error = std::move(h.promise().error);
+                    h.destroy();
+                }
+                void await_resume() noexcept {}
+            };
+            return Final{};
+        }
+
+        void return_void() noexcept {}
+
+        void unhandled_exception() noexcept {
+            error = std::current_exception();
+        }
+
+        CoRoot* co_root() noexcept { return &root; }
+
+        CoRoot root;
+        std::exception_ptr error{};
+    };
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+}  // namespace detail
+
+/**
+ * \brief Coroutine running on an executor
+ *
+ * Starts when awaited from another Co, or when passed to spawn(), and runs
+ * on the executor given to spawn(). The awaitables below suspend it without
+ * blocking the thread, so loops like decoding can be written in one
+ * function and still share a thread with other work, e.g.
+ *
+ * ```
+ * sched::Co<void> decode() {
+ *     while (auto frame = next_frame()) {
+ *         co_await sched::space(buf);
+ *         buf.push(std::move(*frame));
+ *         co_await sched::yield();
+ *     }
+ * }
+ * ```
+ * */
+template <class T>
+class [[nodiscard]] Co {
+ public:
+    using promise_type = detail::CoPromise<T>;
+
+    Co(Co&& other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
+
+    Co& operator=(Co&& other) noexcept {
+        auto tmp = Co(std::move(other));
+        std::swap(m_handle, tmp.m_handle);
+        return *this;
+    }
+
+    ~Co() {
+        if (m_handle) m_handle.destroy();
+    }
+
+    /**
+     * \brief Run the coroutine and resume with its result
+     * */
+    auto operator co_await() && noexcept {
+        return detail::CoAwaiter<T>{m_handle};
+    }
+
+ private:
+    friend promise_type;
+
+    explicit Co(std::coroutine_handle<promise_type> handle) noexcept
+        : m_handle(handle) {}
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+template <class T>
+Co<T> detail::CoPromise<T>::get_return_object() noexcept {
+    return Co<T>(std::coroutine_handle<CoPromise>::from_promise(*this));
+}
+
+inline Co<void> detail::CoPromise<void>::get_return_object() noexcept {
+    return Co<void>(std::coroutine_handle<CoPromise>::from_promise(*this));
+}
+
+namespace detail {
+inline Spawned spawn_root(const Executor& /*exec*/, Co<void> co) {
+    co_await std::move(co);
+}
+}  // namespace detail
+
+/**
+ * \brief Run `co` on `exec`
+ *
+ * Exceptions leaving `co` propagate out of the executor like those of a
+ * Task.
+ * */
+inline void spawn(const Executor& exec, Co<void> co) {
+    auto h = detail::spawn_root(exec, std::move(co)).handle;
+    detail::resume_later(h);
+}
+
+template <detail::executor_provider Ctx>
+void spawn(Ctx& ctx, Co<void> co) {
+    spawn(Executor(ctx.get_executor()), std::move(co));
+}
+
+namespace detail {
+struct YieldAwaiter {
+    bool await_ready() noexcept { return false; }
+
+    template <class P>
+    void await_suspend(std::coroutine_handle<P> h) {
+        resume_later(h);
+    }
+
+    void await_resume() noexcept {}
+};
+
+struct ResumeOnAwaiter {
+    bool await_ready() noexcept { return false; }
+
+    template <class P>
+    void await_suspend(std::coroutine_handle<P> h) {
+        h.promise().co_root()->switch_to(exec);
+        resume_later(h);
+    }
+
+    void await_resume() noexcept {}
+
+    Executor exec;
+};
+
+struct SleepAwaiter {
+    bool await_ready() noexcept { return Clock::now() >= until; }
+
+    template <class P>
+    void await_suspend(std::coroutine_handle<P> h) {
+        timer.emplace(h.promise().co_root()->exec, until);
+        timer->async_wait([h](auto /*ec*/) { resume(h); });
+    }
+
+    void await_resume() noexcept {}
+
+    TimePoint until;
+    std::optional<Timer> timer{};
+};
+}  // namespace detail
+
+/**
+ * \brief Let other work queued on the executor run first
+ * */
+inline auto yield() noexcept { return detail::YieldAwaiter{}; }
+
+/**
+ * \brief Continue the coroutine, and the ones awaiting it, on `exec`
+ * */
+inline auto resume_on(Executor exec) {
+    return detail::ResumeOnAwaiter{std::move(exec)};
+}
+
+/**
+ * \brief Suspend the coroutine until `until`
+ * */
+inline auto sleep_until(TimePoint until) { return detail::SleepAwaiter{until}; }
+
+inline auto sleep_for(Duration dur) { return sleep_until(Clock::now() + dur); }
+
+namespace detail {
+template <class T, bool SPACE>
+struct BufferAwaiter {
+    bool await_ready() noexcept {
+        if constexpr (SPACE) return !buf->full();
+        else return !buf->empty();
+    }
+
+    template <class P>
+    void await_suspend(std::coroutine_handle<P> h) {
+        auto wake = [h] { resume_later(h); };
+        if constexpr (SPACE) buf->when_space(std::move(wake));
+        else buf->when_data(std::move(wake));
+    }
+
+    void await_resume() noexcept {}
+
+    RingBuffer<T>* buf;
+};
+}  // namespace detail
+
+/**
+ * \brief Suspend the coroutine until `buf` is not full
+ *
+ * With several producers the buffer may be full again on resumption.
+ * */
+template <class T>
+auto space(RingBuffer<T>& buf) noexcept {
+    return detail::BufferAwaiter<T, true>{&buf};
+}
+
+/**
+ * \brief Suspend the coroutine until `buf` is not empty, see space()
+ * */
+template <class T>
+auto data(RingBuffer<T>& buf) noexcept {
+    return detail::BufferAwaiter<T, false>{&buf};
+}
+
+/**
+ * \brief Completion token for awaiting an asio-style operation in a Co
+ *
+ * The operation completes on the executor of the coroutine, e.g.
+ * `auto frame = co_await async_pop(buf, sched::use_co);`. Operations
+ * completing with a single value resume with it, ones with several values
+ * with a tuple of them.
+ * */
+struct use_co_t {};
+
+constexpr auto use_co = use_co_t{};
+
+namespace detail {
+template <class Init, class InitArgs, class... Results>
+class OpAwaiter {
+ public:
+    OpAwaiter(Init init, InitArgs args)
+        : m_init(std::move(init)), m_args(std::move(args)) {}
+
+    bool await_ready() noexcept { return false; }
+
+    template <class P>
+    void await_suspend(std::coroutine_handle<P> h) {
+        std::apply(
+            [&](auto&&... args) {
+                std::move(m_init)(Handler{this, h, h.promise().co_root()},
+                                  std::move(args)...);
+            },
+            std::move(m_args));
+    }
+
+    auto await_resume() {
+        if constexpr (sizeof...(Results) == 0) {
+            return;
+        } else if constexpr (sizeof...(Results) == 1) {
+            return std::get<0>(std::move(*m_results));
+        } else {
+            return std::move(*m_results);
+        }
+    }
+
+ private:
+    struct Handler {
+        using executor_type = Executor;
+
+        executor_type get_executor() const noexcept { return root->exec; }
+
+        void operator()(Results... results) {
+            self->m_results.emplace(std::move(results)...);
+            resume(h);
+        }
+
+        OpAwaiter* self;
+        std::coroutine_handle<> h;
+        CoRoot* root;
+    };
+
+    Init m_init;
+    InitArgs m_args;
+    std::optional<std::tuple<Results...>> m_results{};
+};
+}  // namespace detail
+
+}  // namespace plai::sched
+
+template <class R, class... Args>
+struct boost::asio::async_result<plai::sched::use_co_t, R(Args...)> {
+    template <class Init, class... InitArgs>
+    static auto initiate(Init&& init, plai::sched::use_co_t /*token*/,
+                         InitArgs&&... args) {
+        return plai::sched::detail::OpAwaiter<
+            std::decay_t<Init>, std::tuple<std::decay_t<InitArgs>...>,
+            std::decay_t<Args>...>(
+            std::forward<Init>(init),
+            std::make_tuple(std::forward<InitArgs>(args)...));
+    }
+};
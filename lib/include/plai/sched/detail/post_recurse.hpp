@@ -29,19 +29,50 @@ decltype(auto) do_invoke(T&& t, P&& p) {
     }
 }
 
+/**
+ * \brief Executor with the properties of a post, see post_recurse()
+ *
+ * boost::asio::post() requires and prefers these on every call, which
+ * creates a new executor each time, and allocates when an any_io_executor
+ * wraps a strand. Preparing once lets the steps of a chain be executed
+ * directly.
+ * */
+template <class Exec>
+auto prepare_post(const Exec& exec) {
+    namespace execution = boost::asio::execution;
+    return boost::asio::prefer(
+        boost::asio::require(exec, execution::blocking.never),
+        execution::relationship.fork);
+}
+
+/**
+ * \brief Also allocate operations with `alloc`, if `exec` supports that
+ * */
+template <class Exec, class Alloc>
+auto prepare_post(const Exec& exec, const Alloc& alloc) {
+    return boost::asio::prefer(prepare_post(exec),
+                               boost::asio::execution::allocator(alloc));
+}
+
+/**
+ * \brief Run `fn` and the following `fns` on `exec` one after another
+ *
+ * `exec` has to be prepared with prepare_post().
+ * */
 template <class Exec, class P, class Fn, class... Fns>
 void post_recurse(const Exec& exec, P&& p, Fn&& fn, Fns&&... fns) {
+    namespace execution = boost::asio::execution;
     if constexpr (!sizeof...(Fns)) {
         if constexpr (std::same_as<std::remove_cvref_t<P>, no_arg_t>) {
-            boost::asio::post(exec, std::forward<Fn>(fn));
+            execution::execute(exec, std::forward<Fn>(fn));
         } else {
-            boost::asio::post(exec, [arg = std::forward<P>(p),
-                                     fn = std::forward<Fn>(fn)]() mutable {
+            execution::execute(exec, [arg = std::forward<P>(p),
+                                      fn = std::forward<Fn>(fn)]() mutable {
                 std::move(fn)(std::move(arg));
             });
         }
     } else {
-        boost::asio::post(
+        execution::execute(
             exec, [exec, arg = std::forward<P>(p), fn = std::forward<Fn>(fn),
                    ... fns = std::forward<Fns>(fns)]() mutable {
                 post_recurse(exec, do_invoke(std::move(fn), std::move(arg)),
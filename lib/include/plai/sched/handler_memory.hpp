@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+
+namespace plai::sched {
+
+/**
+ * \brief Recycled memory for the handlers of one task
+ *
+ * A task posting itself over and over, like the frame loop of a decoder,
+ * reuses the same few blocks instead of allocating each handler. Requests
+ * that are too large or find all blocks in use go to the heap.
+ * */
+class HandlerMemory {
+ public:
+    static constexpr size_t BLOCK_SIZE = 256;
+    static constexpr size_t BLOCKS = 2;
+
+    HandlerMemory() noexcept = default;
+    HandlerMemory(const HandlerMemory&) = delete;
+    HandlerMemory& operator=(const HandlerMemory&) = delete;
+
+    void* allocate(size_t size) {
+        if (size <= BLOCK_SIZE) {
+            for (auto& block : m_blocks) {
+                if (!block.used.exchange(true, std::memory_order_acquire)) {
+                    return block.data;
+                }
+            }
+        }
+        return ::operator new(size);
+    }
+
+    void deallocate(void* ptr) noexcept {
+        for (auto& block : m_blocks) {
+            if (ptr == block.data) {
+                block.used.store(false, std::memory_order_release);
+                return;
+            }
+        }
+        ::operator delete(ptr);
+    }
+
+ private:
+    struct Block {
+        alignas(std::max_align_t) std::byte data[BLOCK_SIZE];
+        std::atomic<bool> used{false};
+    };
+
+    std::array<Block, BLOCKS> m_blocks{};
+};
+
+/**
+ * \brief Allocator for asio operations backed by HandlerMemory
+ *
+ * Keeps the memory alive until the last operation allocated from it is
+ * gone, so a task may be destroyed while some of its steps are pending.
+ * */
+template <class T>
+class HandlerAllocator {
+ public:
+    using value_type = T;
+
+    explicit HandlerAllocator(std::shared_ptr<HandlerMemory> mem) noexcept
+        : m_mem(std::move(mem)) {}
+
+    template <class U>
+    HandlerAllocator(const HandlerAllocator<U>& other) noexcept
+        : m_mem(other.m_mem) {}
+
+    T* allocate(size_t n) {
+        static_assert(alignof(T) <= alignof(std::max_align_t));
+        return static_cast<T*>(m_mem->allocate(sizeof(T) * n));
+    }
+
+    void deallocate(T* ptr, size_t) noexcept { m_mem->deallocate(ptr); }
+
+    template <class U>
+    friend bool operator==(const HandlerAllocator& a,
+                           const HandlerAllocator<U>& b) noexcept {
+        return a.m_mem == b.m_mem;
+    }
+
+ private:
+    template <class>
+    friend class HandlerAllocator;
+
+    std::shared_ptr<HandlerMemory> m_mem;
+};
+
+}  // namespace plai::sched
@@ -12,10 +12,10 @@ concept executor_provider = requires(T t) {
 template <class Exec, class... Fns>
 void post_chain(Exec&& exec, Fns&&... fns) {
     if constexpr (detail::executor_provider<Exec>) {
-        detail::post_recurse(exec.get_executor(), detail::no_arg,
-                             std::forward<Fns>(fns)...);
+        detail::post_recurse(detail::prepare_post(exec.get_executor()),
+                             detail::no_arg, std::forward<Fns>(fns)...);
     } else {
-        detail::post_recurse(std::forward<Exec>(exec), detail::no_arg,
+        detail::post_recurse(detail::prepare_post(exec), detail::no_arg,
                              std::forward<Fns>(fns)...);
     }
 }
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <boost/asio/execution.hpp>
+#include <boost/asio/execution_context.hpp>
+#include <functional>
+#include <memory>
+#include <plai/sched/executor.hpp>
+
+namespace plai::sched {
+
+struct StealPoolOpts {
+    /// Worker threads, 0 for one per CPU the process may run on
+    size_t threads{0};
+
+    /// Pin worker `i` to the `i`-th CPU the process may run on
+    bool pin{false};
+};
+
+/**
+ * \brief Thread pool for CPU-bound work with a queue per worker
+ *
+ * Work posted from a worker goes to the queue of that worker, other work is
+ * spread over the queues in turn. An idle worker takes half of the queue of
+ * another one before going to sleep, so a worker posting a lot of small
+ * tasks does not keep the others idle, and workers mostly touch their own
+ * queue instead of contending for a shared one.
+ *
+ * The executor is usable as sched::Executor. Like boost::asio::thread_pool
+ * the pool runs until stop() or join() and work tracked through
+ * `boost::asio::execution::outstanding_work.tracked`, e.g. pending timers,
+ * keeps join() waiting.
+ * */
+class StealPool : public boost::asio::execution_context {
+ public:
+    class executor_type;
+
+    explicit StealPool(StealPoolOpts opts = {});
+
+    StealPool(const StealPool&) = delete;
+    StealPool& operator=(const StealPool&) = delete;
+
+    /**
+     * \brief Stops the workers, queued work is discarded
+     * */
+    ~StealPool();
+
+    executor_type get_executor() noexcept;
+
+    size_t size() const noexcept;
+
+    /**
+     * \brief Stop the workers as soon as they finish their current task
+     * */
+    void stop();
+
+    /**
+     * \brief Wait until all work is done and stop the workers
+     * */
+    void join();
+
+ private:
+    using Fn = std::move_only_function<void()>;
+
+    class Impl;
+
+    void submit(Fn fn);
+    void work_started() noexcept;
+    void work_finished() noexcept;
+    bool running_in_this_thread() const noexcept;
+
+    std::unique_ptr<Impl> m_impl;
+};
+
+class StealPool::executor_type {
+ public:
+    executor_type(const executor_type& other) noexcept
+        : m_pool(other.m_pool), m_tracked(other.m_tracked) {
+        if (m_tracked) m_pool->work_started();
+    }
+
+    executor_type& operator=(const executor_type& other) noexcept {
+        executor_type copy(other);
+        std::swap(m_pool, copy.m_pool);
+        std::swap(m_tracked, copy.m_tracked);
+        return *this;
+    }
+
+    ~executor_type() {
+        if (m_tracked) m_pool->work_finished();
+    }
+
+    template <class F>
+    void execute(F&& f) const {
+        m_pool->submit(Fn(std::forward<F>(f)));
+    }
+
+    StealPool& query(boost::asio::execution::context_t) const noexcept {
+        return *m_pool;
+    }
+
+    static constexpr boost::asio::execution::blocking_t query(
+        boost::asio::execution::blocking_t) noexcept {
+        return boost::asio::execution::blocking.never;
+    }
+
+    boost::asio::execution::outstanding_work_t query(
+        boost::asio::execution::outstanding_work_t) const noexcept {
+        if (m_tracked) return boost::asio::execution::outstanding_work.tracked;
+        return boost::asio::execution::outstanding_work.untracked;
+    }
+
+    executor_type require(
+        boost::asio::execution::outstanding_work_t::tracked_t) const noexcept {
+        return executor_type(*m_pool, true);
+    }
+
+    executor_type require(boost::asio::execution::outstanding_work_t::
+                              untracked_t) const noexcept {
+        return executor_type(*m_pool, false);
+    }
+
+    bool running_in_this_thread() const noexcept {
+        return m_pool->running_in_this_thread();
+    }
+
+    friend bool operator==(const executor_type& a,
+                           const executor_type& b) noexcept {
+        return a.m_pool == b.m_pool && a.m_tracked == b.m_tracked;
+    }
+
+ private:
+    friend class StealPool;
+
+    executor_type(StealPool& pool, bool tracked) noexcept
+        : m_pool(&pool), m_tracked(tracked) {
+        if (m_tracked) m_pool->work_started();
+    }
+
+    StealPool* m_pool;
+    bool m_tracked;
+};
+
+inline StealPool::executor_type StealPool::get_executor() noexcept {
+    return {*this, false};
+}
+
+}  // namespace plai::sched
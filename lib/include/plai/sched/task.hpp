@@ -1,7 +1,11 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <memory>
 #include <plai/logs/logs.hpp>
+#include <plai/sched/handler_memory.hpp>
 #include <plai/sched/executor.hpp>
 #include <plai/sched/post_chain.hpp>
 #include <plai/time.hpp>
@@ -33,65 +37,244 @@ class Task {
     std::unique_ptr<detail::TaskImpl> m_impl{};
 };
 
+/**
+ * \brief What a PeriodicTask does after missing ticks
+ * */
+enum class Overrun {
+    /// Drop the missed ticks and continue on the original grid
+    Skip,
+    /// Run the missed ticks back to back, at most MAX_CATCH_UP of them
+    CatchUp,
+    /// Count the late tick for the missed ones and start a new grid
+    Coalesce,
+};
+
+/**
+ * \brief Histogram of how late the ticks of a PeriodicTask fired
+ *
+ * `buckets[i]` counts ticks later than `BOUNDS[i - 1]` and at most
+ * `BOUNDS[i]`, the last bucket the ones later than `BOUNDS.back()`.
+ * */
+struct Lateness {
+    static constexpr std::array<Duration, 8> BOUNDS = {
+        std::chrono::microseconds(100), std::chrono::microseconds(500),
+        std::chrono::milliseconds(1),   std::chrono::milliseconds(2),
+        std::chrono::milliseconds(5),   std::chrono::milliseconds(10),
+        std::chrono::milliseconds(20),  std::chrono::milliseconds(50),
+    };
+
+    std::array<size_t, BOUNDS.size() + 1> buckets{};
+    /// Ticks run
+    size_t ticks{};
+    /// Ticks dropped by Overrun::Skip or Overrun::Coalesce
+    size_t missed{};
+    Duration max{};
+
+    /**
+     * \brief Upper bound of the lateness of the share `q` of ticks
+     *
+     * Duration::max() if it lies in the last bucket.
+     * */
+    Duration quantile(double q) const noexcept {
+        auto target = static_cast<size_t>(q * static_cast<double>(ticks));
+        size_t seen = 0;
+        for (size_t i = 0; i < BOUNDS.size(); ++i) {
+            seen += buckets[i];
+            if (seen > target) return BOUNDS[i];
+        }
+        return Duration::max();
+    }
+};
+
 class PeriodicTask {
+    static constexpr TimePoint NO_ANCHOR = TimePoint::min();
+
     struct Ctx {
         Timer timer;
-        TimePoint start{};
+        TimePoint deadline{};
         std::atomic<Duration> period{};
+        std::atomic<TimePoint> anchor{NO_ANCHOR};
+        Overrun overrun{};
         detail::TaskImpl* impl{};
+        bool idle{};
+
+        std::array<std::atomic<size_t>, Lateness::BOUNDS.size() + 1> buckets{};
+        std::atomic<size_t> ticks{};
+        std::atomic<size_t> missed{};
+        std::atomic<Duration> max_lateness{};
     };
 
  public:
+    /// Missed ticks run by Overrun::CatchUp at most, older ones are dropped
+    static constexpr size_t MAX_CATCH_UP = 4;
+
     template <class Exec>
     PeriodicTask(detail::task_tag_t, Exec exec, Duration period,
+                 Overrun overrun,
                  std::unique_ptr<detail::TaskImpl> impl) noexcept
         : m_impl(std::move(impl)),
           m_ctx(new Ctx{.timer = Timer(std::move(exec)),
+                        .deadline = Clock::now(),
                         .period = std::move(period),
+                        .overrun = overrun,
                         .impl = m_impl.get()}) {
-        loop(m_ctx.get());
+        // the first tick runs right away
+        wait(m_ctx.get());
     }
 
     size_t step_count() const noexcept { return m_impl->step_count(); }
 
+    /**
+     * \brief Change the period, starting after the next tick
+     * */
     void set_period(Duration period) {
         m_ctx->period.store(period, std::memory_order_relaxed);
     }
 
- private:
-    static void loop(Ctx* ctx) {
-        auto now = Clock::now();
-        auto dur = now - ctx->start;
-        auto period = ctx->period.load(std::memory_order_relaxed);
-        auto next = ctx->start + period;
-        if (dur > period) {
-            PLAI_WARN("PeriodicTask overrun");
-            next = now;
+    /**
+     * \brief Move the ticks after the next one onto `tick + k * period`
+     *
+     * Used to follow an external clock, e.g. with the time of a vsync.
+     * */
+    void align(TimePoint tick) {
+        m_ctx->anchor.store(tick, std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Skip the ticks before `until`, e.g. while nothing changes
+     *
+     * Ticking continues with the period from `until`, or from when wake()
+     * is called first. TimePoint::max() idles until wake(). Has to be
+     * called on the executor of the task, e.g. from a step, and like wake()
+     * requires an executor which does not run the task concurrently.
+     * */
+    void idle_until(TimePoint until) {
+        m_ctx->idle = true;
+        m_ctx->deadline = until;
+        wait(m_ctx.get());
+    }
+
+    /**
+     * \brief End idle_until() early with a tick right away
+     *
+     * May be called from any thread, does nothing if the task is not idle
+     * or already destroyed when the executor gets to it.
+     * */
+    void wake() {
+        sched::post(m_ctx->timer.get_executor(),
+                    [weak = std::weak_ptr(m_ctx)] {
+                        auto ctx = weak.lock();
+                        if (!ctx || !ctx->idle) return;
+                        ctx->deadline = Clock::now();
+                        wait(ctx.get());
+                    });
+    }
+
+    /**
+     * \brief Snapshot of the lateness of the ticks so far
+     * */
+    Lateness lateness() const noexcept {
+        Lateness out{};
+        for (size_t i = 0; i < out.buckets.size(); ++i) {
+            out.buckets[i] =
+                m_ctx->buckets[i].load(std::memory_order_relaxed);
         }
-        ctx->start = next;
-        ctx->timer.expires_at(next);
-        ctx->timer.async_wait([ctx = std::move(ctx)](auto ec) mutable {
+        out.ticks = m_ctx->ticks.load(std::memory_order_relaxed);
+        out.missed = m_ctx->missed.load(std::memory_order_relaxed);
+        out.max = m_ctx->max_lateness.load(std::memory_order_relaxed);
+        return out;
+    }
+
+ private:
+    static void wait(Ctx* ctx) {
+        ctx->timer.expires_at(ctx->deadline);
+        ctx->timer.async_wait([ctx](auto ec) {
             if (ec) return;
+            ctx->idle = false;
+            record(ctx, Clock::now() - ctx->deadline);
             ctx->impl->post();
-            loop(ctx);
+            advance(ctx);
+            wait(ctx);
         });
     }
 
+    static void record(Ctx* ctx, Duration late) {
+        const auto& bounds = Lateness::BOUNDS;
+        auto idx = static_cast<size_t>(
+            std::lower_bound(bounds.begin(), bounds.end(), late) -
+            bounds.begin());
+        ctx->buckets[idx].fetch_add(1, std::memory_order_relaxed);
+        ctx->ticks.fetch_add(1, std::memory_order_relaxed);
+        if (late > ctx->max_lateness.load(std::memory_order_relaxed)) {
+            ctx->max_lateness.store(late, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * \brief Compute the deadline of the next tick
+     * */
+    static void advance(Ctx* ctx) {
+        auto period = ctx->period.load(std::memory_order_relaxed);
+        auto next = ctx->deadline + period;
+        auto anchor =
+            ctx->anchor.exchange(NO_ANCHOR, std::memory_order_relaxed);
+        if (anchor != NO_ANCHOR) {
+            // first tick of the new grid after the current one
+            auto offset = (anchor - ctx->deadline) % period;
+            if (offset <= Duration::zero()) offset += period;
+            next = ctx->deadline + offset;
+        }
+        auto now = Clock::now();
+        if (next < now) {
+            // ticks that are already due
+            auto due = static_cast<size_t>((now - next) / period) + 1;
+            size_t drop = 0;
+            switch (ctx->overrun) {
+                case Overrun::Skip:
+                    drop = due;
+                    next += period * drop;
+                    break;
+                case Overrun::CatchUp:
+                    if (due > MAX_CATCH_UP) drop = due - MAX_CATCH_UP;
+                    next += period * drop;
+                    break;
+                case Overrun::Coalesce:
+                    drop = due;
+                    next = now + period;
+                    break;
+            }
+            ctx->missed.fetch_add(drop, std::memory_order_relaxed);
+            PLAI_TRACE("PeriodicTask overrun by {} ticks", due);
+        }
+        ctx->deadline = next;
+    }
+
     std::unique_ptr<detail::TaskImpl> m_impl{};
-    std::unique_ptr<Ctx> m_ctx{};
+    // shared with wake() handlers, which may outlive the task
+    std::shared_ptr<Ctx> m_ctx{};
 };
 
+/**
+ * \brief Steps of a task posted to an executor
+ *
+ * Handlers are allocated from HandlerMemory of the task when the executor
+ * takes an allocator, so tasks that are posted again and again, e.g. once
+ * per frame, do not allocate. An any_io_executor drops the allocator and
+ * falls back to the thread-local recycling of asio.
+ * */
 template <class Exec, class... Fns>
 class TaskImpl : public detail::TaskImpl {
  public:
-    TaskImpl(Exec exec, std::tuple<Fns...> fns) noexcept
-        : m_exec(std::move(exec)), m_fns(std::move(fns)) {}
+    TaskImpl(Exec exec, std::tuple<Fns...> fns)
+        : m_exec(detail::prepare_post(
+              exec, HandlerAllocator<void>(std::make_shared<HandlerMemory>()))),
+          m_fns(std::move(fns)) {}
 
     void post() override {
         if constexpr (sizeof...(Fns)) {
             std::apply(
-                [&](auto&&... args) {
-                    post_chain(m_exec, std::forward<decltype(args)>(args)...);
+                [&](auto&... args) {
+                    detail::post_recurse(m_exec, detail::no_arg, args...);
                 },
                 m_fns);
         }
@@ -100,7 +283,10 @@ class TaskImpl : public detail::TaskImpl {
     size_t step_count() const noexcept override { return sizeof...(Fns); }
 
  private:
-    Exec m_exec;
+    using Prepared = decltype(detail::prepare_post(
+        std::declval<const Exec&>(), std::declval<HandlerAllocator<void>>()));
+
+    Prepared m_exec;
     std::tuple<Fns...> m_fns;
 };
 
@@ -116,6 +302,10 @@ struct Executor {
 struct Period {
     Duration value;
 };
+
+struct OverrunPolicy {
+    Overrun value;
+};
 }  // namespace detail
 
 template <class Exec>
@@ -129,6 +319,11 @@ constexpr auto executor(Exec&& exec) {
 
 constexpr auto period(Duration d) { return detail::Period{d}; }
 
+/**
+ * \brief Overrun policy of a periodic task, Overrun::Skip by default
+ * */
+constexpr auto overrun(Overrun policy) { return detail::OverrunPolicy{policy}; }
+
 constexpr detail::TaskFinish task_finish() noexcept { return {}; }
 
 template <class Exec, class Period, class... Fns>
@@ -138,26 +333,34 @@ class TaskBuilder {
         requires(sizeof...(Fns) == 0)
         : m_exec(std::move(exec)) {}
 
-    constexpr TaskBuilder(Exec exec, Period period,
+    constexpr TaskBuilder(Exec exec, Period period, Overrun overrun,
                           std::tuple<Fns...> fns) noexcept
         : m_exec(std::move(exec)),
           m_period(std::move(period)),
+          m_overrun(overrun),
           m_fns(std::move(fns)) {}
 
     template <class Fn>
     constexpr TaskBuilder<Exec, Period, Fns..., Fn> operator|(Fn&& fn) && {
-        return {std::move(m_exec), std::move(m_period),
+        return {std::move(m_exec), std::move(m_period), m_overrun,
                 std::tuple_cat(std::move(m_fns),
                                std::make_tuple(std::forward<Fn>(fn)))};
     }
 
     template <class E>
     TaskBuilder<E, Period, Fns...> operator|(detail::Executor<E> e) && {
-        return {std::move(e.value), std::move(m_period), std::move(m_fns)};
+        return {std::move(e.value), std::move(m_period), m_overrun,
+                std::move(m_fns)};
     }
 
     TaskBuilder<Exec, Duration, Fns...> operator|(detail::Period p) && {
-        return {std::move(m_exec), std::move(p.value), std::move(m_fns)};
+        return {std::move(m_exec), std::move(p.value), m_overrun,
+                std::move(m_fns)};
+    }
+
+    TaskBuilder operator|(detail::OverrunPolicy o) && {
+        m_overrun = o.value;
+        return std::move(*this);
     }
 
     auto operator|(detail::TaskFinish) && {
@@ -168,7 +371,7 @@ class TaskBuilder {
                         std::make_unique<TaskImpl<Exec, Fns...>>(
                             std::move(m_exec), std::move(m_fns)));
         } else {
-            return PeriodicTask(detail::task_tag, m_exec, m_period,
+            return PeriodicTask(detail::task_tag, m_exec, m_period, m_overrun,
                                 std::make_unique<TaskImpl<Exec, Fns...>>(
                                     m_exec, std::move(m_fns)));
         }
@@ -177,6 +380,7 @@ class TaskBuilder {
  private:
     Exec m_exec;
     Period m_period{};
+    Overrun m_overrun{Overrun::Skip};
     std::tuple<Fns...> m_fns{};
 };
 
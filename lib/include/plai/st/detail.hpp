@@ -1,10 +1,14 @@
 #pragma once
 
+#include <array>
+#include <concepts>
 #include <cstddef>
 #include <plai/concepts.hpp>
 #include <plai/exceptions.hpp>
 #include <plai/st/tag.hpp>
+#include <plai/st/wake.hpp>
 #include <plai/thirdparty/magic_enum.hpp>
+#include <utility>
 
 namespace plai::st::detail {
 
@@ -17,15 +21,87 @@ constexpr auto init_state = magic_enum::enum_value<E>(0);
 template <concepts::enum_type E>
 constexpr auto done_state = magic_enum::enum_value<E>(state_count<E> - 1);
 
-template <size_t Idx, class T, concepts::enum_type E, class... Ps>
-constexpr decltype(auto) tag_step(T& t, E e, Ps&&... ps) {
-    constexpr auto enum_value = magic_enum::enum_value<E>(Idx);
-    if (e == enum_value) {
-        return t.step(tag<enum_value>, std::forward<Ps>(ps)...);
-    }
-    if constexpr (Idx < state_count<E> - 2)
-        return tag_step<Idx + 1>(t, e, std::forward<Ps>(ps)...);
-    else
+template <class T, concepts::enum_type E, size_t Idx, class... Ps>
+constexpr E step_at(T& t, Ps&&... ps) {
+    if constexpr (Idx + 1 < state_count<E>) {
+        return t.step(tag<magic_enum::enum_value<E>(Idx)>,
+                      std::forward<Ps>(ps)...);
+    } else {
         throw ValueError("Invalid state");
+    }
+}
+
+/**
+ * \brief Steps of `T` for each state of `E`, indexed by the enum index
+ * */
+template <class T, concepts::enum_type E, class... Ps>
+constexpr auto step_table =
+    []<size_t... Is>(std::index_sequence<Is...>) {
+        return std::array<E (*)(T&, Ps&&...), sizeof...(Is)>{
+            &step_at<T, E, Is, Ps...>...};
+    }(std::make_index_sequence<state_count<E>>{});
+
+template <class T, concepts::enum_type E, size_t Idx>
+constexpr Wake wake_at(const T& t) {
+    constexpr auto state = magic_enum::enum_value<E>(Idx);
+    if constexpr (Idx + 1 == state_count<E>) {
+        return Wake::never();
+    } else if constexpr (requires {
+                             { t.wake(tag<state>) } -> std::same_as<Wake>;
+                         }) {
+        return t.wake(tag<state>);
+    } else {
+        return Wake::tick();
+    }
+}
+
+/**
+ * \brief Wake-up of `T` for each state of `E`, see step_table
+ * */
+template <class T, concepts::enum_type E>
+constexpr auto wake_table =
+    []<size_t... Is>(std::index_sequence<Is...>) {
+        return std::array<Wake (*)(const T&), sizeof...(Is)>{
+            &wake_at<T, E, Is>...};
+    }(std::make_index_sequence<state_count<E>>{});
+
+/**
+ * \brief Whether the values of `E` are `0, 1, ...`, so they are indices
+ * */
+template <concepts::enum_type E>
+constexpr bool dense_enum = [] {
+    for (size_t i = 0; i < state_count<E>; ++i) {
+        if (std::to_underlying(magic_enum::enum_value<E>(i)) !=
+            static_cast<std::underlying_type_t<E>>(i))
+            return false;
+    }
+    return true;
+}();
+
+template <concepts::enum_type E>
+constexpr size_t state_index(E e) {
+    if constexpr (dense_enum<E>) {
+        auto idx = static_cast<size_t>(std::to_underlying(e));
+        if (idx >= state_count<E>) throw ValueError("Invalid state");
+        return idx;
+    } else {
+        auto idx = magic_enum::enum_index(e);
+        if (!idx) throw ValueError("Invalid state");
+        return *idx;
+    }
+}
+
+/**
+ * \brief Call the step of `t` for state `e` with a single indirect call
+ * */
+template <class T, concepts::enum_type E, class... Ps>
+constexpr E table_step(T& t, E e, Ps&&... ps) {
+    return step_table<T, E, Ps...>[state_index(e)](t,
+                                                   std::forward<Ps>(ps)...);
+}
+
+template <class T, concepts::enum_type E>
+constexpr Wake table_wake(const T& t, E e) {
+    return wake_table<T, E>[state_index(e)](t);
 }
 }  // namespace plai::st::detail
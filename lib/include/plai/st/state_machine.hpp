@@ -1,12 +1,41 @@
 #pragma once
 
+#include <plai/concepts.hpp>
 #include <plai/logs/logs.hpp>
 #include <plai/st/detail.hpp>
 #include <plai/st/tag.hpp>
+#include <plai/st/wake.hpp>
 #include <plai/thirdparty/magic_enum.hpp>
 
 namespace plai::st {
 
+/**
+ * \brief `T` wants to know when StateMachine<T> changed its state
+ * */
+template <class T>
+concept transition_hook =
+    requires(T& t, typename T::state_type from, typename T::state_type to) {
+        t.on_transition(from, to);
+    };
+
+/**
+ * \brief Debug log of a transition, for use in `on_transition()`
+ * */
+template <concepts::enum_type E>
+void log_transition(E /*from*/, E to) {
+    PLAI_DEBUG("Reached state {}::{}", magic_enum::enum_type_name<E>(),
+               magic_enum::enum_name(to));
+}
+
+/**
+ * \brief Drives `T` through the states of `T::state_type`
+ *
+ * Each call runs `T::step(tag<S>, ps...)` of the current state `S` through
+ * a jump table and moves to the state it returns. The first state of the
+ * enum is the initial one, the last the final one. If `T` has
+ * `on_transition(from, to)`, it is called after each change of state.
+ * States may declare when they need the next step, see wake().
+ * */
 template <class T>
 class StateMachine {
  public:
@@ -29,11 +58,10 @@ class StateMachine {
     constexpr void operator()(Ps&&... ps) {
         assert(!done());
         auto prev_st = m_st;
-        m_st = detail::tag_step<0>(m_impl, m_st, std::forward<Ps>(ps)...);
-        if (m_st != prev_st)
-            PLAI_DEBUG("Reached state {}::{}",
-                       magic_enum::enum_type_name<state_type>(),
-                       magic_enum::enum_name(m_st));
+        m_st = detail::table_step(m_impl, m_st, std::forward<Ps>(ps)...);
+        if constexpr (transition_hook<T>) {
+            if (m_st != prev_st) m_impl.on_transition(prev_st, m_st);
+        }
     }
 
     constexpr void reset() noexcept {
@@ -46,6 +74,14 @@ class StateMachine {
         m_impl = T(std::forward<Ts>(ts)...);
     }
 
+    /**
+     * \brief When the machine has to be stepped next
+     *
+     * From `T::wake(tag_t<S>) const` of the current state `S` if there is
+     * one, Wake::tick() otherwise and Wake::never() once done.
+     * */
+    constexpr Wake wake() const { return detail::table_wake(m_impl, m_st); }
+
     constexpr state_type state() const noexcept { return m_st; }
     constexpr bool initial() const noexcept { return m_st == init_state; }
     constexpr bool done() const noexcept { return m_st == done_state; }
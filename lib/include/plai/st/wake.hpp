@@ -0,0 +1,53 @@
+#pragma once
+
+#include <algorithm>
+#include <plai/time.hpp>
+
+namespace plai::st {
+
+/**
+ * \brief When a state machine has to be stepped next
+ *
+ * Declared by a state through `Wake wake(tag_t<S>) const`, see
+ * StateMachine::wake(). A driver may skip steps until the deadline passes,
+ * or until new input arrives if the state waits for some.
+ * */
+struct Wake {
+    /// Step at the latest at this time, TimePoint::min() for every tick
+    TimePoint deadline{TimePoint::min()};
+    /// Also step as soon as new input arrives
+    bool input{false};
+
+    /**
+     * \brief Step on every tick of the driver, the default for all states
+     * */
+    static constexpr Wake tick() noexcept { return {}; }
+
+    static constexpr Wake at(TimePoint tp) noexcept {
+        return {.deadline = tp};
+    }
+
+    static constexpr Wake on_input() noexcept {
+        return {.deadline = TimePoint::max(), .input = true};
+    }
+
+    static constexpr Wake never() noexcept {
+        return {.deadline = TimePoint::max()};
+    }
+
+    constexpr bool ticking() const noexcept {
+        return deadline == TimePoint::min();
+    }
+
+    /**
+     * \brief Wake up when either `a` or `b` would
+     * */
+    friend constexpr Wake operator|(const Wake& a, const Wake& b) noexcept {
+        return {.deadline = std::min(a.deadline, b.deadline),
+                .input = a.input || b.input};
+    }
+
+    friend constexpr bool operator==(const Wake&, const Wake&) = default;
+};
+
+}  // namespace plai::st
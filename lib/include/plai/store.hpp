@@ -1,10 +1,14 @@
 #pragma once
 
+#include <algorithm>
 #include <memory>
 #include <optional>
 #include <plai/c_str.hpp>
 #include <plai/crypto.hpp>
+#include <plai/exceptions.hpp>
+#include <plai/time.hpp>
 #include <plai/virtual.hpp>
+#include <string>
 #include <vector>
 
 namespace plai {
@@ -16,6 +20,103 @@ struct BlobMeta {
     bool marked_for_deletion;
 };
 
+/**
+ * \brief Outcome of Store::lock()
+ * */
+struct LockResult {
+    /// Requested keys that are not in the store
+    std::vector<std::string> missing{};
+
+    /// Whether all the keys were locked
+    explicit operator bool() const noexcept { return missing.empty(); }
+};
+
+/**
+ * \brief Blob added by Store::store_many()
+ * */
+struct StoreItem {
+    CStr key;
+    std::span<const uint8_t> blob;
+    /// SHA-256 of `blob` if it is known already, it is not verified
+    std::optional<crypto::Sha256> digest{};
+};
+
+/**
+ * \brief Outcome of Store::compact()
+ * */
+struct CompactStats {
+    /// Pages returned to the file system
+    size_t freed_pages{};
+    /// Unused pages left in the database
+    size_t free_pages{};
+    /// Size of a page in bytes
+    size_t page_size{};
+};
+
+/**
+ * \brief Data did not match the digest it was expected to have
+ * */
+class DigestMismatch : public ValueError {
+ public:
+    using ValueError::ValueError;
+};
+
+/**
+ * \brief Incremental writer for a single blob
+ *
+ * Created via Store::writer(). The data becomes visible in the store only
+ * after commit() succeeds. Destroying the writer without committing discards
+ * everything written so far.
+ * */
+class StoreWriter : public Virtual {
+ public:
+    /**
+     * \brief Append data to the blob
+     *
+     * Throws ValueError if the data would exceed the size given when the
+     * writer was created.
+     * */
+    virtual void write(std::span<const uint8_t> data) = 0;
+
+    /**
+     * \brief Publish the written blob
+     *
+     * Throws ValueError if fewer bytes were written than expected and
+     * DigestMismatch if the data does not match the expected digest. The blob
+     * is discarded in both cases.
+     *
+     * \return Metadata of the stored blob
+     * */
+    virtual BlobMeta commit() = 0;
+};
+
+/**
+ * \brief Random access to a single blob
+ *
+ * Created via Store::reader(). Reads see the blob as it was when the reader
+ * was created, even if the key is overwritten or removed meanwhile.
+ * */
+class StoreReader : public Virtual {
+ public:
+    /**
+     * \brief Size of the blob in bytes
+     * */
+    virtual size_t size() const noexcept = 0;
+
+    /**
+     * \brief Read from `offset` on
+     *
+     * \return Number of bytes read into `out`, fewer than requested only at
+     * the end of the blob
+     * */
+    virtual size_t read(size_t offset, std::span<uint8_t> out) = 0;
+};
+
+/**
+ * \brief Storage of media blobs by key
+ *
+ * Methods may be called from several threads concurrently.
+ * */
 class Store : public Virtual {
  public:
     /**
@@ -32,6 +133,49 @@ class Store : public Virtual {
      * */
     virtual void store(CStr key, std::span<const uint8_t> blob) = 0;
 
+    /**
+     * \brief Add several blobs in a single transaction
+     *
+     * Either all or none of the keys are added. Cheaper than store() per blob
+     * when adding many blobs at once, e.g. when seeding a new store. Digests
+     * missing from the items are calculated.
+     * */
+    virtual void store_many(std::span<const StoreItem> items) = 0;
+
+    /**
+     * \brief Add a blob to the store in chunks
+     *
+     * Unlike store() this does not require the whole blob to be in memory.
+     * The digest is calculated as the data is written.
+     *
+     * \param key Key for the data
+     * \param expected_size Total size of the blob in bytes
+     * \param expected_digest Digest the data is verified against on commit
+     * */
+    virtual std::unique_ptr<StoreWriter> writer(
+        CStr key, size_t expected_size,
+        std::optional<crypto::Sha256> expected_digest) = 0;
+
+    std::unique_ptr<StoreWriter> writer(CStr key, size_t expected_size) {
+        return writer(key, expected_size, std::nullopt);
+    }
+
+    /**
+     * \brief Add a key for data already in the store
+     *
+     * Blobs are stored once per digest and shared by all keys with the same
+     * content, so this makes uploading data that is already present
+     * unnecessary.
+     *
+     * \param key Key for the data
+     * \param digest Digest of the data
+     *
+     * \return Metadata of the blob or std::nullopt if no blob with the digest
+     * is stored
+     * */
+    virtual std::optional<BlobMeta> link(CStr key,
+                                         const crypto::Sha256& digest) = 0;
+
     /**
      * \brief Get metadata about a blob
      *
@@ -49,9 +193,9 @@ class Store : public Virtual {
      *
      * \param keys Keys of the blobs to lock
      *
-     * \return true if lock was successfull, false on failure
+     * \return The keys that are missing when locking failed
      * */
-    virtual bool lock(std::span<CStr> keys) = 0;
+    virtual LockResult lock(std::span<CStr> keys) = 0;
 
     /**
      * \brief Unlock blobs
@@ -68,6 +212,32 @@ class Store : public Virtual {
      * */
     virtual std::vector<uint8_t> read(CStr key) = 0;
 
+    /**
+     * \brief Open a blob for reading parts of it
+     *
+     * Unlike read() this does not load the whole blob into memory.
+     *
+     * \throw ValueError if there is no blob with the key
+     * */
+    virtual std::unique_ptr<StoreReader> reader(CStr key) = 0;
+
+    /**
+     * \brief Read up to `len` bytes of a blob starting at `offset`
+     *
+     * Cheaper than a reader for a single read, as no snapshot has to be
+     * kept.
+     *
+     * \return The data, shorter than `len` if the blob ends before
+     * */
+    virtual std::vector<uint8_t> read_range(CStr key, size_t offset,
+                                            size_t len) {
+        auto r = reader(key);
+        if (offset >= r->size()) return {};
+        std::vector<uint8_t> out(std::min(len, r->size() - offset));
+        out.resize(r->read(offset, out));
+        return out;
+    }
+
     /**
      * \brief Remove a blob
      *
@@ -78,8 +248,86 @@ class Store : public Virtual {
      * \param key Key of the blob to delete
      * */
     virtual void remove(CStr key) = 0;
+
+    /**
+     * \brief Return up to `max_pages` unused pages to the file system
+     *
+     * Removed blobs leave unused pages behind in the database. Later writes
+     * reuse them, but the file does not shrink on its own. Writes wait while
+     * this runs, so large databases are better compacted a few pages at a
+     * time. With `max_pages` 0 nothing is freed, only the stats are returned.
+     * Nothing is freed either in databases created before compaction was
+     * supported, see SqliteOpts::rebuild_for_compaction.
+     * */
+    virtual CompactStats compact(size_t max_pages) = 0;
 };
 
-std::unique_ptr<Store> sqlite_store(CStr path);
+/**
+ * \brief Tuning of the SQLite database
+ *
+ * The database is always opened in WAL mode so that reads do not block on
+ * a write in progress and vice versa. It uses incremental auto vacuum, see
+ * Store::compact(), existing databases are converted once when opened.
+ * */
+struct SqliteOpts {
+    /// Values of PRAGMA synchronous
+    enum class Synchronous : uint8_t { Off, Normal, Full };
+
+    /**
+     * \brief How often to sync to disk
+     *
+     * With NORMAL the last transactions may be lost on power failure, but the
+     * database stays consistent.
+     * */
+    Synchronous synchronous{Synchronous::Normal};
+
+    /// Bytes of the database to access via memory mapping, 0 disables it
+    int64_t mmap_size{256 * 1024 * 1024};
+
+    /// Size of the page cache in KiB, per connection
+    int64_t cache_size_kib{8 * 1024};
+
+    /**
+     * \brief Maximum number of read-only connections
+     *
+     * Reads run on these in parallel to each other and to writes, which go
+     * through a single connection. In-memory databases and 0 use the writer
+     * connection for everything. Only used by sqlite_store().
+     * */
+    size_t max_readers{4};
+
+    /**
+     * \brief Age after which a StoreReader moves to a newer snapshot
+     *
+     * The read transaction of a reader keeps the WAL from being checkpointed
+     * past it, so it grows with writes for as long as the reader holds on to
+     * its snapshot. Without read-only connections readers copy the blob
+     * instead. Only used by sqlite_store().
+     * */
+    Duration max_snapshot_age{std::chrono::seconds(5)};
+
+    /**
+     * \brief Rebuild databases that can not be compacted when opened
+     *
+     * Store::compact() needs incremental auto vacuum, which new databases
+     * get right away. Databases created before have to be rebuilt once with
+     * VACUUM, which blocks opening the store for as long as it takes and
+     * needs free space for two copies of the database. Skipped if there is
+     * not enough of it.
+     * */
+    bool rebuild_for_compaction{false};
+};
+
+std::unique_ptr<Store> sqlite_store(CStr path, const SqliteOpts& opts = {});
+
+/**
+ * \brief Store payloads as files in the directory `path`
+ *
+ * Only metadata is kept in an SQLite index inside the directory, configured
+ * by `opts`. Payloads are stored once per digest and read without going
+ * through SQLite, which suits large media. `opts.synchronous` set to Off also
+ * skips syncing payload files.
+ * */
+std::unique_ptr<Store> fs_store(CStr path, const SqliteOpts& opts = {});
 
 }  // namespace plai
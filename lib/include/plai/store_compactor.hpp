@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <plai/sched/executor.hpp>
+#include <plai/sched/task.hpp>
+#include <plai/store.hpp>
+#include <plai/time.hpp>
+
+namespace plai {
+
+struct CompactorOpts {
+    /// Time between two steps
+    Duration period{std::chrono::seconds(1)};
+
+    /// Maximum number of pages freed per step
+    size_t pages_per_step{64};
+};
+
+/**
+ * \brief Compacts a Store in the background
+ *
+ * Calls Store::compact() periodically on an executor, a few pages at a time
+ * so that a step holds up writes only briefly. Steps are skipped while
+ * `idle` returns false, e.g. to compact only while a still image is shown.
+ *
+ * The executor has to be stopped before the compactor is destroyed, and the
+ * store has to outlive both.
+ * */
+class StoreCompactor {
+ public:
+    /// Totals since construction
+    struct Metrics {
+        /// Steps that ran Store::compact()
+        size_t steps{};
+        size_t freed_pages{};
+        size_t freed_bytes{};
+        /// Unused pages left after the last step
+        size_t free_pages{};
+    };
+
+    StoreCompactor(Store& store, sched::Executor exec,
+                   std::function<bool()> idle = {}, CompactorOpts opts = {});
+
+    StoreCompactor(const StoreCompactor&) = delete;
+    StoreCompactor& operator=(const StoreCompactor&) = delete;
+
+    Metrics metrics() const noexcept;
+
+ private:
+    void step();
+
+    Store* m_store;
+    std::function<bool()> m_idle;
+    size_t m_pages_per_step;
+    std::atomic<size_t> m_steps{};
+    std::atomic<size_t> m_freed_pages{};
+    std::atomic<size_t> m_freed_bytes{};
+    std::atomic<size_t> m_free_pages{};
+    // declared last, it starts stepping once constructed
+    sched::PeriodicTask m_task;
+};
+
+}  // namespace plai
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <algorithm>
+#include <filesystem>
+#include <optional>
+#include <plai/store.hpp>
+#include <string>
+#include <thread>
+
+namespace plai {
+
+struct ImportOpts {
+    /// Files hashed in parallel
+    size_t jobs{std::max(1u, std::thread::hardware_concurrency())};
+
+    /// Bytes of files stored per transaction, larger files are streamed
+    size_t batch_bytes{256 * 1024 * 1024};
+};
+
+/**
+ * \brief Outcome of import_dir()
+ * */
+struct ImportStats {
+    /// Files whose content was added to the store
+    size_t imported{};
+    /// Files whose content was stored under another key already
+    size_t linked{};
+    /// Files already stored under their key
+    size_t skipped{};
+    /// Files that do not map to a media key
+    size_t ignored{};
+    /// Bytes added to the store
+    size_t bytes{};
+};
+
+/**
+ * \brief Key of the file at `rel`, relative to the imported directory
+ *
+ * Only `image/<name>` and `video/<name>` can be served by the API, so other
+ * paths, including ones nested deeper, have no key.
+ *
+ * \return The key or std::nullopt if the file is not to be imported
+ * */
+std::optional<std::string> import_key(const std::filesystem::path& rel);
+
+/**
+ * \brief Import the media files in `dir` into `store`
+ *
+ * Files are hashed in parallel, content already in the store is linked
+ * instead of stored again. Files without an import_key() are skipped with a
+ * warning.
+ * */
+ImportStats import_dir(Store& store, const std::filesystem::path& dir,
+                       const ImportOpts& opts = {});
+
+}  // namespace plai
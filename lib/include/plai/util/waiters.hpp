@@ -0,0 +1,35 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <utility>
+
+namespace plai {
+
+/**
+ * \brief Queue of one-shot callbacks waiting for a state of a container
+ *
+ * Not synchronized, the container guards it with its own mutex and calls
+ * the callback it takes after unlocking.
+ * */
+class Waiters {
+ public:
+    using Fn = std::move_only_function<void()>;
+
+    void add(Fn fn) { m_fns.push_back(std::move(fn)); }
+
+    /**
+     * \brief Remove the oldest callback, empty if there is none
+     * */
+    Fn take() {
+        if (m_fns.empty()) return {};
+        auto res = std::move(m_fns.front());
+        m_fns.pop_front();
+        return res;
+    }
+
+ private:
+    std::deque<Fn> m_fns{};
+};
+
+}  // namespace plai
@@ -1,7 +1,14 @@
 #include <openssl/evp.h>
 #include <openssl/sha.h>
 
+#include <cassert>
+#include <exception>
 #include <plai/crypto.hpp>
+#include <plai/exceptions.hpp>
+#include <plai/persist_buffer.hpp>
+#include <thread>
+#include <utility>
+#include <vector>
 
 namespace plai::crypto {
 
@@ -33,4 +40,132 @@ std::string hex_str(Sha256View data) {
     }
     return res;
 }
+
+std::optional<Sha256> parse_sha256(std::string_view hex) {
+    constexpr auto to_nibble = [](char c) -> std::optional<uint8_t> {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return std::nullopt;
+    };
+    Sha256 out{};
+    if (hex.size() != out.size() * 2) return std::nullopt;
+    for (size_t i = 0; i < out.size(); ++i) {
+        auto upper = to_nibble(hex[2 * i]);
+        auto lower = to_nibble(hex[(2 * i) + 1]);
+        if (!upper || !lower) return std::nullopt;
+        out.at(i) = static_cast<uint8_t>((*upper << 4) | *lower);
+    }
+    return out;
+}
+
+Sha256Hasher::Sha256Hasher() : m_ctx(EVP_MD_CTX_new()) {
+    if (!m_ctx) throw std::bad_alloc();
+    if (!EVP_DigestInit_ex(m_ctx, EVP_sha256(), nullptr)) {
+        EVP_MD_CTX_free(m_ctx);
+        throw ValueError("failed to initialize SHA256 context");
+    }
+}
+
+Sha256Hasher::Sha256Hasher(Sha256Hasher&& other) noexcept
+    : m_ctx(std::exchange(other.m_ctx, nullptr)) {}
+
+Sha256Hasher& Sha256Hasher::operator=(Sha256Hasher&& other) noexcept {
+    auto tmp = Sha256Hasher(std::move(other));
+    std::swap(m_ctx, tmp.m_ctx);
+    return *this;
+}
+
+Sha256Hasher::~Sha256Hasher() {
+    if (m_ctx) EVP_MD_CTX_free(m_ctx);
+}
+
+void Sha256Hasher::update(std::span<const uint8_t> data) {
+    if (!EVP_DigestUpdate(m_ctx, data.data(), data.size()))
+        throw ValueError("failed to update SHA256 digest");
+}
+
+Sha256 Sha256Hasher::finish() {
+    Sha256 out{};
+    unsigned size{};
+    if (!EVP_DigestFinal_ex(m_ctx, out.data(), &size))
+        throw ValueError("failed to finalize SHA256 digest");
+    EVP_DigestInit_ex(m_ctx, EVP_sha256(), nullptr);
+    return out;
+}
+
+class BackgroundSha256Hasher::Impl {
+    // Chunks in flight. Buffers are recycled between the threads so steady
+    // state hashing does not allocate.
+    static constexpr size_t QUEUE_SIZE = 4;
+
+ public:
+    Impl() : m_thread([this] { run(); }) {}
+
+    Impl(const Impl&) = delete;
+    Impl& operator=(const Impl&) = delete;
+    Impl(Impl&&) = delete;
+    Impl& operator=(Impl&&) = delete;
+
+    ~Impl() {
+        if (m_thread.joinable()) stop();
+    }
+
+    void update(std::span<const uint8_t> data) {
+        // empty chunk is reserved for signaling the end
+        if (data.empty()) return;
+        m_spare.assign(data.begin(), data.end());
+        m_spare = m_queue.push(std::move(m_spare));
+    }
+
+    Sha256 finish() {
+        assert(m_thread.joinable() && "finish() called twice");
+        stop();
+        if (m_error) std::rethrow_exception(m_error);
+        return m_hasher.finish();
+    }
+
+ private:
+    void stop() {
+        m_spare.clear();
+        m_queue.push(std::move(m_spare));
+        m_thread.join();
+    }
+
+    void run() {
+        std::vector<uint8_t> prev{};
+        while (true) {
+            auto chunk = m_queue.pop(std::move(prev));
+            if (chunk.empty()) return;
+            // keep draining the queue on errors so the producer never blocks
+            if (!m_error) {
+                try {
+                    m_hasher.update(chunk);
+                } catch (...) { m_error = std::current_exception(); }
+            }
+            prev = std::move(chunk);
+        }
+    }
+
+    Sha256Hasher m_hasher{};
+    PersistBuffer<std::vector<uint8_t>> m_queue{QUEUE_SIZE};
+    std::vector<uint8_t> m_spare{};
+    std::exception_ptr m_error{};
+    // started last so the members above are initialized when run() starts
+    std::thread m_thread;
+};
+
+BackgroundSha256Hasher::BackgroundSha256Hasher()
+    : m_impl(std::make_unique<Impl>()) {}
+BackgroundSha256Hasher::BackgroundSha256Hasher(
+    BackgroundSha256Hasher&&) noexcept = default;
+BackgroundSha256Hasher& BackgroundSha256Hasher::operator=(
+    BackgroundSha256Hasher&&) noexcept = default;
+BackgroundSha256Hasher::~BackgroundSha256Hasher() = default;
+
+void BackgroundSha256Hasher::update(std::span<const uint8_t> data) {
+    m_impl->update(data);
+}
+
+Sha256 BackgroundSha256Hasher::finish() { return m_impl->finish(); }
 }  // namespace plai::crypto
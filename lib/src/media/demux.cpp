@@ -17,6 +17,26 @@ namespace {
 namespace demux_detail {
 
 constexpr size_t AV_IO_BUFFER_SIZE = 8 * 1024;
+
+/**
+ * \brief Source for a buffer owned by the caller
+ * */
+class SpanSource final : public ByteSource {
+ public:
+    explicit SpanSource(std::span<const uint8_t> buf) noexcept : m_buf(buf) {}
+
+    size_t size() const noexcept override { return m_buf.size(); }
+
+    size_t read(size_t offset, std::span<uint8_t> out) override {
+        if (offset >= m_buf.size()) return 0;
+        auto count = std::min(out.size(), m_buf.size() - offset);
+        std::memcpy(out.data(), &m_buf[offset], count);
+        return count;
+    }
+
+ private:
+    std::span<const uint8_t> m_buf;
+};
 }  // namespace demux_detail
 }  // namespace
 
@@ -25,7 +45,15 @@ Demux::Demux() : m_ctx(avformat_alloc_context()) {
 }
 
 Demux::Demux(std::span<const uint8_t> buf)
-    : m_buf(buf), m_ctx(avformat_alloc_context()) {
+    : Demux(std::make_shared<demux_detail::SpanSource>(buf)) {}
+
+Demux::Demux(const Media& media)
+    : Demux(media.source() ? media.source()
+                           : std::make_shared<demux_detail::SpanSource>(
+                                 media.data())) {}
+
+Demux::Demux(std::shared_ptr<ByteSource> src)
+    : m_src(std::move(src)), m_ctx(avformat_alloc_context()) {
     if (!m_ctx) throw std::bad_alloc();
 
     void* iobuf = av_malloc(demux_detail::AV_IO_BUFFER_SIZE +
@@ -56,7 +84,8 @@ Demux::Demux(const stdfs::path& src) : Demux() {
 }
 
 Demux::Demux(Demux&& other) noexcept
-    : m_buf(std::exchange(other.m_buf, {})),
+    : m_src(std::exchange(other.m_src, {})),
+      m_offset(std::exchange(other.m_offset, 0)),
       m_ctx(std::exchange(other.m_ctx, nullptr)),
       m_io_ctx(std::exchange(other.m_io_ctx, nullptr)) {
     if (m_io_ctx) m_io_ctx->opaque = this;
@@ -64,7 +93,8 @@ Demux::Demux(Demux&& other) noexcept
 
 Demux& Demux::operator=(Demux&& other) noexcept {
     auto tmp = std::move(*this);
-    std::swap(m_buf, other.m_buf);
+    std::swap(m_src, other.m_src);
+    std::swap(m_offset, other.m_offset);
     std::swap(m_ctx, other.m_ctx);
     std::swap(m_io_ctx, other.m_io_ctx);
     if (m_io_ctx) m_io_ctx->opaque = this;
@@ -104,52 +134,57 @@ std::pair<std::size_t, StreamView> Demux::best_video_stream() {
 
 int Demux::buffer_read(void* userdata, uint8_t* buf, int buflen) noexcept {
     Demux* self = static_cast<Demux*>(userdata);
-    assert(self->m_buf_offset <= self->m_buf.size());
-    PLAI_TRACE("buffer_read: size: {}, offset: {}", self->m_buf.size(),
-               self->m_buf_offset);
-    size_t left_in_buf = self->m_buf.size() - self->m_buf_offset;
-    if (!left_in_buf) {
-        PLAI_TRACE("end-of-file");
-        return AVERROR_EOF;
+    PLAI_TRACE("buffer_read: size: {}, offset: {}", self->m_src->size(),
+               self->m_offset);
+    try {
+        auto count = self->m_src->read(
+            self->m_offset, std::span(buf, static_cast<size_t>(buflen)));
+        if (!count) {
+            PLAI_TRACE("end-of-file");
+            return AVERROR_EOF;
+        }
+        self->m_offset += count;
+        PLAI_TRACE("read {} bytes", count);
+        return static_cast<int>(count);
+    } catch (const std::exception& e) {
+        PLAI_ERR("failed to read media: {}", e.what());
+        return AVERROR(EIO);
     }
-    auto count = std::min(buflen, static_cast<int>(left_in_buf));
-    std::memcpy(buf, &self->m_buf[self->m_buf_offset], count);
-    self->m_buf_offset += count;
-    PLAI_TRACE("read {} bytes", count);
-    return count;
 }
 
 int64_t Demux::buffer_seek(void* userdata, int64_t offset,
                            int origin) noexcept {
     Demux* self = static_cast<Demux*>(userdata);
     PLAI_TRACE("seek offset: current_offset={}, new_offset={}, origin={}",
-               self->m_buf_offset, offset, origin);
+               self->m_offset, offset, origin);
     if (origin & AVSEEK_SIZE) {
-        return static_cast<int64_t>(self->m_buf.size());
+        return static_cast<int64_t>(self->m_src->size());
     }
     switch (origin) {
         case SEEK_SET: {  // 0
             PLAI_TRACE("SEEK_SET");
             if (offset < 0) return -1;
-            if (static_cast<size_t>(offset) > self->m_buf.size()) return -1;
-            self->m_buf_offset = offset;
+            if (static_cast<size_t>(offset) > self->m_src->size()) return -1;
+            self->m_offset = offset;
             return 0;
         }
         case SEEK_CUR: {  // 1
             PLAI_TRACE("SEEK_CUR");
-            auto new_idx = static_cast<int64_t>(self->m_buf_offset) + offset;
+            auto new_idx = static_cast<int64_t>(self->m_offset) + offset;
             if (new_idx < 0 ||
-                static_cast<uint64_t>(new_idx) >= self->m_buf.size())
+                static_cast<uint64_t>(new_idx) >= self->m_src->size())
                 return -1;
-            self->m_buf_offset += offset;
+            self->m_offset += offset;
             return 0;
         }
         case SEEK_END: {  // 2
             PLAI_TRACE("SEEK_END");
             if (offset > 0) return -1;
-            if (-offset >= static_cast<int64_t>(self->m_buf.size())) return -1;
-            self->m_buf_offset = self->m_buf.size() + offset;
-            PLAI_TRACE("new offset: {}", self->m_buf_offset);
+            if (-offset >= static_cast<int64_t>(self->m_src->size())) {
+                return -1;
+            }
+            self->m_offset = self->m_src->size() + offset;
+            PLAI_TRACE("new offset: {}", self->m_offset);
             return 0;
         }
         default: return -1;
@@ -3,8 +3,7 @@
 #include <plai/media/demux.hpp>
 #include <plai/media/hwaccel.hpp>
 #include <plai/mods/decoder.hpp>
-#include <plai/sched/task.hpp>
-#include <plai/util/memfn.hpp>
+#include <plai/sched/co.hpp>
 
 namespace plai::mods {
 
@@ -20,9 +19,10 @@ class DecoderImpl final : public Decoder {
             auto lk = std::lock_guard(m_mut);
             m_media = std::move(media);
             PLAI_DEBUG("Decoder consuming media with size {}",
-                       m_media->data().size());
+                       m_media->source() ? m_media->source()->size()
+                                         : m_media->data().size());
         }
-        sched::post(m_exec, memfn(this, &DecoderImpl::launch_decoding));
+        sched::spawn(m_exec, decode());
     }
 
     bool sink_ready() override {
@@ -37,30 +37,38 @@ class DecoderImpl final : public Decoder {
     bool src_ready() override { return !m_frame_buf.empty(); }
 
  private:
-    void launch_decoding() {
-        auto lk = std::unique_lock(m_mut);
-        m_demux.emplace(m_media->data());
-        m_decoded_frames = 0;
-        lk.unlock();
-        std::tie(m_stream_idx, m_stream) = m_demux->best_video_stream();
-        auto still = m_stream.is_still_image();
-        m_decoder = media::Decoder(m_stream);
+    sched::Co<void> decode() {
+        {
+            auto lk = std::lock_guard(m_mut);
+            m_demux.emplace(*m_media);
+        }
+        auto [stream_idx, stream] = m_demux->best_video_stream();
+        m_stream_idx = stream_idx;
+        auto still = stream.is_still_image();
+        m_decoder = media::Decoder(stream);
+        auto meta =
+            Decoded(DecodingMeta{.fps = still ? NaN<int> : stream.fps()});
+        while (!try_push(meta)) co_await sched::space(m_frame_buf);
         if (still) {
-            m_frame_buf.emplace(DecodingMeta{.fps = NaN<int>});
-            m_still_decode.post();
+            co_await decode_still();
         } else {
-            m_frame_buf.emplace(DecodingMeta{.fps = m_stream.fps()});
-            m_video_decode.post();
+            co_await decode_video();
         }
-        notify_src_ready();
+        auto end = Decoded(EndOfMedia{});
+        while (!try_push(end)) co_await sched::space(m_frame_buf);
+        {
+            auto lk = std::lock_guard(m_mut);
+            m_media.reset();
+        }
+        notify_sink_ready();
     }
 
     // Still image might have metadata like icons which needs to be discarded so
     // we just select the frame with the largest width.
     //
-    // This could be optimized a bit to run in multiple steps if this takes too
-    // long.
-    void decode_step_still() {
+    // This could be optimized a bit to yield between packets if this takes
+    // too long.
+    sched::Co<void> decode_still() {
         auto pkt = media::Packet();
         auto frm = media::Frame();
         auto real_frm = media::Frame();
@@ -71,31 +79,37 @@ class DecoderImpl final : public Decoder {
             if (frm.width() > real_frm.width())
                 real_frm = std::exchange(frm, {});
         }
-        m_frame_buf.push(std::move(real_frm));
-        {
-            auto lk = std::lock_guard(m_mut);
-            m_media.reset();
-        }
-        notify_src_ready();
-        notify_sink_ready();
+        auto item = Decoded(std::move(real_frm));
+        while (!try_push(item)) co_await sched::space(m_frame_buf);
     }
 
-    void decode_step() {
+    sched::Co<void> decode_video() {
         auto pkt = media::Packet();
         auto frm = media::Frame();
+        size_t decoded_frames = 0;
         while (*m_demux >> pkt) {
             if (pkt.stream_index() != m_stream_idx) continue;
             m_decoder << pkt;
             if (!(m_decoder >> frm)) continue;
-            m_frame_buf.push(std::move(frm));
-            notify_src_ready();
-            ++m_decoded_frames;
-            m_video_decode.post();
-            return;
+            auto item = Decoded(std::exchange(frm, {}));
+            while (!try_push(item)) co_await sched::space(m_frame_buf);
+            ++decoded_frames;
+            // let other decoders and pipeline stages run between frames
+            co_await sched::yield();
         }
-        PLAI_DEBUG("decoded total {} frames", m_decoded_frames);
-        m_media.reset();
-        notify_sink_ready();
+        PLAI_DEBUG("decoded total {} frames", decoded_frames);
+    }
+
+    /**
+     * \brief Push `item` unless the frame buffer is full
+     *
+     * Callers wait for space with sched::space() and retry. Not a coroutine
+     * itself, as each call would allocate a frame.
+     * */
+    bool try_push(Decoded& item) {
+        if (!m_frame_buf.try_emplace(std::move(item))) return false;
+        notify_src_ready();
+        return true;
     }
 
     std::mutex m_mut{};
@@ -103,16 +117,7 @@ class DecoderImpl final : public Decoder {
 
     std::optional<media::Demux> m_demux{};
     unsigned long m_stream_idx{};
-    media::StreamView m_stream{};
     media::Decoder m_decoder{};
-    size_t m_decoded_frames{};
-
-    sched::Task m_video_decode = sched::task() | sched::executor(m_exec) |
-                                 memfn(this, &DecoderImpl::decode_step) |
-                                 sched::task_finish();
-    sched::Task m_still_decode = sched::task() | sched::executor(m_exec) |
-                                 memfn(this, &DecoderImpl::decode_step_still) |
-                                 sched::task_finish();
 
     std::optional<media::Media> m_media{};
     static constexpr size_t FRAME_BUFFER_SIZE = 10;
@@ -35,8 +35,19 @@ class PlayerImpl final : public Player {
     }
 
     void consume(Decoded decoded) override {
-        auto lk = std::lock_guard(m_ctx.mut);
-        m_ctx.buf = std::move(decoded);
+        if (std::holds_alternative<EndOfMedia>(decoded)) {
+            notify_sink_ready();
+            return;
+        }
+        auto lk = std::unique_lock(m_ctx.mut);
+        if (auto* meta = std::get_if<DecodingMeta>(&decoded)) {
+            m_ctx.buf = *meta;
+        } else {
+            m_ctx.buf = std::get<media::Frame>(std::move(decoded));
+        }
+        auto wake = m_wake_on_input;
+        lk.unlock();
+        if (wake) m_render_task.wake();
     }
 
     bool sink_ready() override {
@@ -69,6 +80,20 @@ class PlayerImpl final : public Player {
             }
         }
         m_front->render_current();
+        idle();
+    }
+
+    /**
+     * \brief Stop rendering until the state machine has something to do
+     * */
+    void idle() {
+        auto wake = m_sm.wake();
+        auto lk = std::unique_lock(m_ctx.mut);
+        m_wake_on_input = wake.input;
+        // input which arrived during the step would not wake the task
+        if (wake.ticking() || (wake.input && m_ctx.buf)) return;
+        lk.unlock();
+        m_render_task.idle_until(wake.deadline);
     }
 
     sched::Executor m_exec;
@@ -80,11 +105,14 @@ class PlayerImpl final : public Player {
         sched::task_finish();
 
     sched::PeriodicTask m_render_task =
-        sched::task() | sched::period(500ms) | sched::executor(m_exec) |
+        sched::task() | sched::period(500ms) |
+        sched::overrun(sched::Overrun::Skip) | sched::executor(m_exec) |
         memfn(this, &PlayerImpl::step) | sched::task_finish();
 
     player::Ctx m_ctx;
     st::StateMachine<player::RootSm> m_sm{std::in_place, m_ctx};
+    // guarded by m_ctx.mut
+    bool m_wake_on_input{};
 };
 std::unique_ptr<Player> make_player(sched::Executor exec, Frontend* frontend,
                                     play::PlayerOpts opts) {
@@ -2,7 +2,7 @@
 
 namespace plai::mods::player {
 
-std::optional<Decoded> Ctx::extract_buf() {
+std::optional<Input> Ctx::extract_buf() {
     auto lk = std::unique_lock(mut);
     auto item = std::exchange(buf, std::nullopt);
     lk.unlock();
@@ -19,10 +19,17 @@ constexpr Duration PERIOD_30MS = std::chrono::microseconds(33'333);
 constexpr Duration PERIOD_60MS = std::chrono::microseconds(16'667);
 constexpr auto MAX_ALPHA = std::numeric_limits<uint8_t>::max();
 
+/**
+ * \brief Decoded items the state machines handle
+ *
+ * EndOfMedia is dropped when consumed, a media ends when the next one starts.
+ * */
+using Input = std::variant<DecodingMeta, media::Frame>;
+
 struct Ctx {
     static constexpr auto DEFAULT_DIMS = Vec<int>{1920, 1080};
     std::mutex mut{};
-    std::optional<Decoded> buf{};
+    std::optional<Input> buf{};
     play::PlayerOpts opts{};
     media::Frame frm{};
     media::Frame prev_frm{};
@@ -37,6 +44,6 @@ struct Ctx {
 
     std::function<void()> notify_sink_ready;
 
-    std::optional<Decoded> extract_buf();
+    std::optional<Input> extract_buf();
 };
 }  // namespace plai::mods::player
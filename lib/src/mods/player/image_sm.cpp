@@ -42,4 +42,14 @@ auto ImageSm::step(st::tag_t<Delay>) -> state_type {
 
 auto ImageSm::step(st::tag_t<End>) -> state_type { return Done; }
 
+st::Wake ImageSm::wake(st::tag_t<Init>) const {
+    if (!m_ctx->frm) return st::Wake::on_input();
+    return st::Wake::tick();
+}
+
+st::Wake ImageSm::wake(st::tag_t<Delay>) const {
+    // the shown image stays on screen without rendering it again
+    return st::Wake::at(m_tstamp + m_ctx->opts.image_dur);
+}
+
 }  // namespace plai::mods::player
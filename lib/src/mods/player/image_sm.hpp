@@ -1,6 +1,7 @@
 #pragma once
 
 #include <plai/st/tag.hpp>
+#include <plai/st/wake.hpp>
 
 #include "mods/player/ctx.hpp"
 
@@ -25,6 +26,9 @@ class ImageSm {
     state_type step(st::tag_t<Delay>);
     state_type step(st::tag_t<End>);
 
+    st::Wake wake(st::tag_t<Init>) const;
+    st::Wake wake(st::tag_t<Delay>) const;
+
     constexpr void reset() const noexcept {}
 
  private:
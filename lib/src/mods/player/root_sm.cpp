@@ -90,6 +90,12 @@ auto RootSm::step(st::tag_t<Img>) -> state_type {
     return Img;
 }
 
+st::Wake RootSm::wake(st::tag_t<Img>) const {
+    // waiting for the next media once the image was shown
+    if (m_img_sm.done()) return st::Wake::on_input();
+    return m_img_sm.wake();
+}
+
 auto RootSm::step(st::tag_t<Vid2Vid>) -> state_type {
     if (m_blend_sm.initial()) { m_blend_sm->setup(false, false); }
     m_blend_sm();
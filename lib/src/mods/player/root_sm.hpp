@@ -42,6 +42,13 @@ class RootSm {
     state_type step(st::tag_t<Img2Vid>);
     state_type step(st::tag_t<Img2Img>);
 
+    st::Wake wake(st::tag_t<Init>) const { return st::Wake::on_input(); }
+    st::Wake wake(st::tag_t<Img>) const;
+
+    void on_transition(state_type from, state_type to) {
+        st::log_transition(from, to);
+    }
+
  private:
     Ctx* m_ctx;
     st::StateMachine<ImageSm> m_img_sm{std::in_place, *m_ctx};
@@ -7,6 +7,16 @@
 
 namespace plai::net {
 namespace {
+// Optional request header for verifying uploads. Uses the same
+// "sha256:<hex>" format as the digest returned by GET /media/{type}/{name}.
+constexpr std::string_view DIGEST_HEADER = "X-Digest";
+
+std::optional<crypto::Sha256> parse_digest(std::string_view value) {
+    auto [algo, hex] = split_left(value, ":");
+    if (algo != "sha256") return std::nullopt;
+    return crypto::parse_sha256(hex);
+}
+
 std::string to_str(const MediaListEntry& v) {
     return plai::format(R"({{"type": "{}", "key": "{}"}})",
                         serialize_media_type(v.type), v.key);
@@ -61,17 +71,39 @@ MediaMeta DefaultApi::get_media(MediaType type, std::string_view key) {
 }
 
 void DefaultApi::put_media(
-    MediaType type, std::string_view key,
+    MediaType type, std::string_view key, std::optional<size_t> size,
+    std::optional<crypto::Sha256> digest,
     std::function<std::optional<std::span<const uint8_t>>()> body) {
-    std::vector<uint8_t> buf{};
+    auto s = plai::format("{}/{}", plai::net::serialize_media_type(type), key);
+    if (digest && m_store->link(s, *digest)) {
+        PLAI_INFO("media {} already stored, skipping upload", s);
+        return;
+    }
+    if (!size) {
+        // No Content-Length (chunked transfer encoding) so the size is only
+        // known after receiving everything.
+        std::vector<uint8_t> buf{};
+        auto hasher = crypto::Sha256Hasher();
+        while (true) {
+            auto r = body();
+            if (!r) break;
+            if (digest) hasher.update(*r);
+            buf.insert(buf.end(), r->begin(), r->end());
+        }
+        PLAI_INFO("media {} with size {}", s, buf.size());
+        if (digest && hasher.finish() != *digest)
+            throw DigestMismatch(plai::format("digest mismatch for {}", s));
+        m_store->store(s, buf);
+        return;
+    }
+    PLAI_INFO("media {} with size {}", s, *size);
+    auto writer = m_store->writer(s, *size, digest);
     while (true) {
         auto r = body();
         if (!r) break;
-        buf.insert(buf.end(), r->begin(), r->end());
+        writer->write(*r);
     }
-    auto s = plai::format("{}/{}", plai::net::serialize_media_type(type), key);
-    PLAI_INFO("media {} with size {}", s, buf.size());
-    m_store->store(s, buf);
+    writer->commit();
 }
 
 DeleteResult DefaultApi::delete_media(MediaType type, std::string_view key) {
@@ -104,6 +136,8 @@ std::unique_ptr<ApiServer> launch_api(ApiV1* api, std::string_view bind) {
         http::ServerBuilder()
             .bind(std::string(bind))
             .prefix("/plai/v1")
+            // ApiV1 is required to be thread-safe
+            .concurrent_handlers()
             .service("/_ping", http::METHOD_GET,
                      [api](const http::Request& req) -> http::Response {
                          api->ping();
@@ -130,8 +164,21 @@ std::unique_ptr<ApiServer> launch_api(ApiV1* api, std::string_view bind) {
                                     crypto::hex_str(meta.digest), meta.size)};
                     }
                     if (req.method() == http::METHOD_PUT) {
-                        api->put_media(*type, name,
-                                       [&]() { return req.data_chunked(); });
+                        auto digest_str = req.header(DIGEST_HEADER);
+                        auto digest = digest_str.and_then(parse_digest);
+                        if (digest_str && !digest) {
+                            return {.body = "invalid digest",
+                                    .status_code = PLAI_HTTP(400)};
+                        }
+                        try {
+                            api->put_media(
+                                *type, name, req.content_length(), digest,
+                                [&]() { return req.data_chunked(); });
+                        } catch (const DigestMismatch& e) {
+                            PLAI_WARN("rejected upload: {}", e.what());
+                            return {.body = "digest mismatch",
+                                    .status_code = PLAI_HTTP(400)};
+                        }
                         return {.body = "done", .status_code = PLAI_HTTP(200)};
                     }
                     if (req.method() == http::METHOD_DELETE) {
@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <plai/format.hpp>
+#include <plai/net/http/router.hpp>
+
+namespace plai::net::http {
+namespace {
+
+constexpr size_t END = std::string_view::npos;
+
+constexpr size_t first_segment(std::string_view str) noexcept {
+    return str.empty() ? END : 0;
+}
+
+/**
+ * \brief Pop the '/' separated segment starting at `pos`
+ *
+ * `pos` is set to the start of the following segment or END if this was the
+ * last one.
+ * */
+constexpr std::string_view next_segment(std::string_view str,
+                                        size_t& pos) noexcept {
+    auto slash = str.find('/', pos);
+    auto seg = str.substr(pos, slash == END ? END : slash - pos);
+    pos = slash == END ? END : slash + 1;
+    return seg;
+}
+
+}  // namespace
+
+struct Router::Lookup {
+    Method method;
+    const Endpoint* endpoint{};
+    // target matched a pattern, but not for the requested method
+    bool path_found{};
+};
+
+void Router::add(std::string_view pattern, Method methods, Route route) {
+    Index node = 0;
+    std::vector<std::string> params{};
+    for (auto pos = first_segment(pattern); pos != END;) {
+        auto seg = next_segment(pattern, pos);
+        if (seg.starts_with('{')) {
+            if (seg.size() < 2 || !seg.ends_with('}')) {
+                throw ValueError(plai::format("invalid pattern '{}'", pattern));
+            }
+            if (params.size() == PathParams::MAX_SIZE) {
+                throw ValueError(
+                    plai::format("too many parameters in '{}'", pattern));
+            }
+            params.emplace_back(seg.substr(1, seg.size() - 2));
+            if (m_nodes[node].param_child == NONE) {
+                m_nodes[node].param_child = m_nodes.size();
+                m_nodes.emplace_back();
+            }
+            node = m_nodes[node].param_child;
+            continue;
+        }
+        auto& children = m_nodes[node].children;
+        auto iter = std::ranges::find(children, seg, [](const auto& c) {
+            return std::string_view(c.first);
+        });
+        if (iter != children.end()) {
+            node = iter->second;
+            continue;
+        }
+        auto child = static_cast<Index>(m_nodes.size());
+        children.emplace_back(std::string(seg), child);
+        m_nodes.emplace_back();
+        node = child;
+    }
+
+    auto& endpoints = m_nodes[node].endpoints;
+    for (const auto& e : endpoints) {
+        if (e.methods & methods) {
+            throw ValueError(
+                plai::format("conflicting routes for '{}'", pattern));
+        }
+    }
+    endpoints.push_back({methods, route, std::move(params)});
+}
+
+auto Router::match(std::string_view target, Method method) const noexcept
+    -> std::optional<Match> {
+    Values values{};
+    Lookup res{.method = method};
+    if (!match_node(0, target, first_segment(target), values, 0, res)) {
+        if (res.path_found) return Match{std::nullopt, Target(target, {})};
+        return std::nullopt;
+    }
+    PathParams params{};
+    for (size_t i = 0; i < res.endpoint->params.size(); ++i) {
+        params.set(res.endpoint->params[i], values.at(i));
+    }
+    return Match{res.endpoint->route, Target(target, params)};
+}
+
+bool Router::match_node(Index idx, std::string_view tgt, size_t pos,
+                        Values& values, size_t depth,
+                        Lookup& out) const noexcept {
+    const auto& node = m_nodes[idx];
+    if (pos == END) {
+        for (const auto& e : node.endpoints) {
+            if (e.methods & out.method) {
+                out.endpoint = &e;
+                return true;
+            }
+        }
+        if (!node.endpoints.empty()) out.path_found = true;
+        return false;
+    }
+    auto seg = next_segment(tgt, pos);
+    for (const auto& [name, child] : node.children) {
+        if (name == seg) {
+            if (match_node(child, tgt, pos, values, depth, out)) return true;
+            break;
+        }
+    }
+    if (node.param_child == NONE) return false;
+    values.at(depth) = seg;
+    return match_node(node.param_child, tgt, pos, values, depth + 1, out);
+}
+
+}  // namespace plai::net::http
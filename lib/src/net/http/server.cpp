@@ -1,12 +1,19 @@
 #include <utility>
 // above needed for a missing header in boost
+#include <poll.h>
+
+#include <algorithm>
 #include <boost/asio.hpp>
 #include <boost/beast.hpp>
+#include <cerrno>
+#include <limits>
 #include <filesystem>
+#include <mutex>
+#include <thread>
 #include <plai/format.hpp>
 #include <plai/logs/logs.hpp>
+#include <plai/net/http/router.hpp>
 #include <plai/net/http/server.hpp>
-#include <plai/util/defer.hpp>
 
 namespace plai::net::http {
 namespace local = boost::asio::local;
@@ -70,61 +77,136 @@ struct ServiceKey {
 using ServiceHandler = std::function<Response(const Request&)>;
 using ServiceMap = std::map<ServiceKey, ServiceHandler>;
 
+struct Service {
+    std::string pattern;
+    ServiceHandler handler;
+};
+
+/**
+ * \brief Services compiled for dispatch
+ *
+ * Routes of the router index into `services`.
+ * */
+struct Routes {
+    Router router{};
+    std::vector<Service> services{};
+};
+
 http::response<http::string_body> make_boost_response(const Response& resp,
-                                                      unsigned http_version) {
+                                                      unsigned http_version,
+                                                      bool keep_alive) {
     http::response<http::string_body> out{http::int_to_status(resp.status_code),
                                           http_version};
+    out.keep_alive(keep_alive);
     out.set(http::field::server, "plai media player");
     out.set(http::field::content_type, "text/plain");
     out.body() = std::move(resp.body);
     out.prepare_payload();
     return out;
 }
+
+/**
+ * \brief Synchronous reads from a socket that fail after a timeout
+ *
+ * Timeouts of beast::basic_stream only apply to asynchronous operations, but
+ * handlers read request bodies synchronously. A read fails with
+ * beast::error::timeout if no data arrives for `timeout`.
+ * */
+class TimedReadStream {
+ public:
+    TimedReadStream(local::stream_protocol::socket& sock,
+                    Duration timeout) noexcept
+        : m_sock(&sock), m_timeout(timeout) {}
+
+    template <class Buffers>
+    size_t read_some(const Buffers& bufs, boost::system::error_code& ec) {
+        if (!wait_readable(ec)) return 0;
+        return m_sock->read_some(bufs, ec);
+    }
+
+    template <class Buffers>
+    size_t read_some(const Buffers& bufs) {
+        boost::system::error_code ec{};
+        auto n = read_some(bufs, ec);
+        if (ec) throw boost::system::system_error(ec);
+        return n;
+    }
+
+ private:
+    bool wait_readable(boost::system::error_code& ec) const {
+        const auto ms =
+            std::chrono::ceil<std::chrono::milliseconds>(m_timeout).count();
+        auto pfd = pollfd{
+            .fd = m_sock->native_handle(), .events = POLLIN, .revents = 0};
+        while (true) {
+            auto res = ::poll(&pfd, 1,
+                              static_cast<int>(std::clamp<int64_t>(
+                                  ms, 0, std::numeric_limits<int>::max())));
+            if (res > 0) return true;
+            if (res == 0) {
+                ec = beast::error::timeout;
+                return false;
+            }
+            if (errno != EINTR) {
+                ec = {errno, boost::system::system_category()};
+                return false;
+            }
+        }
+    }
+
+    local::stream_protocol::socket* m_sock;
+    Duration m_timeout;
+};
 }  // namespace
 
 struct ParsingCtx {
-    static constexpr size_t CHUNK_SIZE = 10 * 1024 * 1024;
+    static constexpr size_t CHUNK_SIZE = 1024 * 1024;
     beast::flat_buffer flat_buf{};
     beast::basic_stream<local::stream_protocol> stream;
-    http::request_parser<http::buffer_body> parser{};
+    // parsers cannot be reused so a new one is created for each request
+    std::optional<http::request_parser<http::buffer_body>> parser{};
     std::vector<uint8_t> buf{};
+    // bytes of buf holding body data, the rest is scratch space for reads
+    size_t buf_len{};
     unsigned http_version{};
-
-    explicit ParsingCtx(
-        beast::basic_stream<local::stream_protocol> stream) noexcept
-        : stream(std::move(stream)) {
-        parser.body_limit(std::numeric_limits<size_t>::max());
-    }
-
-    void read_header() {
-        http::read_header(stream, flat_buf, parser);
-        http_version = parser.get().version();
+    // for reading the body, without data for this long the request fails
+    Duration read_timeout;
+
+    explicit ParsingCtx(beast::basic_stream<local::stream_protocol> stream,
+                        Duration read_timeout) noexcept
+        : stream(std::move(stream)), read_timeout(read_timeout) {}
+
+    /**
+     * \brief Prepare for reading the next request on the connection
+     * */
+    void reset() {
+        parser.emplace();
+        parser->body_limit(std::numeric_limits<size_t>::max());
+        buf_len = 0;
+        // don't keep memory from e.g. text() of a big request around while
+        // the connection idles
+        if (buf.size() > CHUNK_SIZE) buf = {};
     }
 
-    bool is_done() const noexcept { return parser.is_done(); }
+    bool is_done() const noexcept { return parser->is_done(); }
 
     boost::system::error_code read_next() noexcept {
-        // append next chunk to buf
-        auto offset = buf.size();
-        buf.resize(buf.size() + CHUNK_SIZE);
-        auto& body = parser.get().body();
-        body.data = &buf.at(offset);
-        body.size = buf.size() - offset;
+        // append next chunk to buf, only growing it when the free space runs
+        // out so chunked reads keep reusing the same memory
+        if (buf.size() - buf_len < CHUNK_SIZE)
+            buf.resize(std::max(buf.size() * 2, buf_len + CHUNK_SIZE));
+        auto& body = parser->get().body();
+        body.data = &buf.at(buf_len);
+        body.size = buf.size() - buf_len;
         boost::system::error_code ec{};
-        http::read(stream, flat_buf, parser, ec);
+        auto timed = TimedReadStream(stream.socket(), read_timeout);
+        http::read(timed, flat_buf, *parser, ec);
         if (!ec || ec == http::error::need_buffer) {
-            const auto unused = body.size;
-            buf.resize(buf.size() - unused);
+            buf_len = buf.size() - body.size;
             ec = {};
         }
         return ec;
     }
-
-    void respond(const Response& resp) {
-        boost::system::error_code ec{};
-        http::write(stream, make_boost_response(resp, http_version), ec);
-        if (ec) PLAI_WARN("failed to respond: '{}'", ec.message());
-    }
 };
 
 // wrapper for beast parser, allows lazy reading
@@ -148,29 +230,162 @@ class RequestImpl final : public Request {
             if (ec) throw boost::system::system_error(ec);
         }
         return {reinterpret_cast<const char*>(m_ctx->buf.data()),
-                m_ctx->buf.size()};
+                m_ctx->buf_len};
     }
 
     const QueryParams& query_params() const override { return *m_params; }
 
+    std::optional<size_t> content_length() const override {
+        auto len = m_ctx->parser->content_length();
+        if (!len) return std::nullopt;
+        return *len;
+    }
+
+    std::optional<std::string_view> header(
+        std::string_view name) const override {
+        const auto& fields = m_ctx->parser->get();
+        auto iter =
+            fields.find(beast::string_view(name.data(), name.size()));
+        if (iter == fields.end()) return std::nullopt;
+        return std::string_view(iter->value());
+    }
+
     std::optional<std::string_view> text_chunked() const override {
-        m_ctx->buf.clear();
+        m_ctx->buf_len = 0;
         if (m_ctx->is_done()) return std::nullopt;
         auto ec = m_ctx->read_next();
         if (ec) throw boost::system::system_error(ec);
         return std::string_view{
             reinterpret_cast<const char*>(m_ctx->buf.data()),
-            m_ctx->buf.size()};
+            m_ctx->buf_len};
+    }
+};
+
+/**
+ * \brief A single client connection
+ *
+ * Requests are served one after another until the client closes the
+ * connection, asks for it to be closed or stays idle for too long. Pipelined
+ * requests wait in the read buffer until the previous response is written.
+ *
+ * Header is read and the response written asynchronously. The handler runs
+ * on the worker thread that completed the header read and may block it while
+ * lazily reading the body, so concurrent requests need more worker threads.
+ * A client that stops sending the body fails the request after the idle
+ * timeout rather than holding the worker.
+ * */
+class Session : public std::enable_shared_from_this<Session> {
+ public:
+    Session(local::stream_protocol::socket sock, const Routes& routes,
+            std::mutex* handler_mut, Duration idle_timeout)
+        : m_ctx(beast::basic_stream<local::stream_protocol>(std::move(sock)),
+                idle_timeout),
+          m_routes(&routes),
+          m_handler_mut(handler_mut),
+          m_idle_timeout(idle_timeout) {}
+
+    void start() {
+        m_ctx.reset();
+        m_ctx.stream.expires_after(m_idle_timeout);
+        http::async_read_header(
+            m_ctx.stream, m_ctx.flat_buf, *m_ctx.parser,
+            [self = shared_from_this()](boost::system::error_code ec,
+                                        size_t /*unused*/) {
+                self->on_header(ec);
+            });
+    }
+
+ private:
+    void on_header(boost::system::error_code ec) {
+        if (ec == http::error::end_of_stream) return;
+        if (ec == beast::error::timeout) {
+            PLAI_TRACE("closing idle connection");
+            return;
+        }
+        if (ec) {
+            PLAI_DEBUG("failed to read request header: '{}'", ec.message());
+            return;
+        }
+        m_ctx.http_version = m_ctx.parser->get().version();
+        auto resp = dispatch();
+        // Unread body would be parsed as the next request. Close the
+        // connection instead of draining a possibly huge upload.
+        auto keep_alive = m_ctx.parser->get().keep_alive() && m_ctx.is_done();
+        m_resp = make_boost_response(resp, m_ctx.http_version, keep_alive);
+        // the handler may have taken longer than the deadline of the header
+        m_ctx.stream.expires_after(m_idle_timeout);
+        http::async_write(m_ctx.stream, m_resp,
+                          [self = shared_from_this()](
+                              boost::system::error_code ec, size_t /*unused*/) {
+                              self->on_write(ec);
+                          });
     }
+
+    void on_write(boost::system::error_code ec) {
+        if (ec) {
+            PLAI_WARN("failed to respond: '{}'", ec.message());
+            return;
+        }
+        if (m_resp.need_eof()) {
+            m_ctx.stream.socket().shutdown(
+                local::stream_protocol::socket::shutdown_send, ec);
+            return;
+        }
+        start();
+    }
+
+    Response dispatch() {
+        const auto& msg = m_ctx.parser->get();
+        auto url_str = std::string_view(msg.target());
+        auto [tgt_str, param_str] = split_left(url_str, "?");
+        auto verb = convert_boost_verb(msg.method());
+        PLAI_DEBUG("transfer encoding: {}",
+                   std::string_view(msg[http::field::transfer_encoding]));
+        if (!verb) {
+            return {.body = "Unsupported method",
+                    .status_code = PLAI_HTTP(405)};
+        }
+        auto match = m_routes->router.match(tgt_str, *verb);
+        if (!match) return {.body = "Not found", .status_code = PLAI_HTTP(404)};
+        if (!match->route) {
+            return {.body = "Method not allowed",
+                    .status_code = PLAI_HTTP(405)};
+        }
+        const auto& [pattern, handler] = m_routes->services[*match->route];
+        PLAI_DEBUG("handler: '{}'", pattern);
+        auto query_params = parse_query_params(param_str);
+        RequestImpl req{*verb, match->target, m_ctx, query_params};
+        auto lk = m_handler_mut ? std::unique_lock(*m_handler_mut)
+                                : std::unique_lock<std::mutex>();
+        try {
+            return handler(req);
+        } catch (const std::exception& e) {
+            PLAI_ERR("handler '{}' failed: {}", pattern, e.what());
+            return {.body = "Internal server error",
+                    .status_code = PLAI_HTTP(500)};
+        }
+    }
+
+    ParsingCtx m_ctx;
+    const Routes* m_routes;
+    // serializes the handlers unless they may run concurrently
+    std::mutex* m_handler_mut;
+    Duration m_idle_timeout;
+    http::response<http::string_body> m_resp{};
 };
 
 class Server::Impl {
  public:
-    Impl(std::string socket, ServiceMap services)
-        : m_sock(std::move(socket)), m_services(std::move(services)) {
+    Impl(std::string socket, Routes routes, size_t threads,
+         bool concurrent_handlers, Duration idle_timeout)
+        : m_sock(std::move(socket)),
+          m_routes(std::move(routes)),
+          m_threads(std::max<size_t>(threads, 1)),
+          m_concurrent_handlers(concurrent_handlers),
+          m_idle_timeout(idle_timeout) {
         PLAI_DEBUG("registered API handlers:");
-        for (const auto& [key, _] : m_services) {
-            PLAI_DEBUG("  '{}'", key.pattern);
+        for (const auto& service : m_routes.services) {
+            PLAI_DEBUG("  '{}'", service.pattern);
         }
     }
 
@@ -179,17 +394,26 @@ class Server::Impl {
         if (fs::exists(m_sock)) { fs::remove(m_sock); }
         m_acceptor = local::stream_protocol::acceptor(
             m_ioc, local::stream_protocol::endpoint(m_sock));
+        accept();
+        std::vector<std::jthread> workers{};
+        workers.reserve(m_threads - 1);
+        for (size_t i = 1; i < m_threads; ++i) {
+            workers.emplace_back([&] { m_ioc.run(); });
+        }
+        m_ioc.run();
+    }
+
+    void stop() { m_ioc.stop(); }
+
+ private:
+    void accept() {
         m_acceptor.async_accept(m_ioc,
                                 [&](const boost::system::error_code& ec,
                                     local::stream_protocol::socket sock) {
                                     step(ec, std::move(sock));
                                 });
-        m_ioc.run();
     }
 
-    void stop() { m_ioc.stop(); }
-
- private:
     void step(boost::system::error_code ec,
               local::stream_protocol::socket sock) {
         if (ec == boost::asio::error::operation_aborted) {
@@ -202,47 +426,26 @@ class Server::Impl {
             m_ioc.stop();
             return;
         }
-        if (ec) throw boost::system::system_error(ec);
-        auto defer = Defer{[&] {
-            m_acceptor.async_accept(
-                m_ioc,
-                [&](const auto& ec, local::stream_protocol::socket sock) {
-                    step(ec, std::move(sock));
-                });
-        }};
-        auto ctx = ParsingCtx(
-            beast::basic_stream<local::stream_protocol>(std::move(sock)));
-
-        ctx.read_header();
-        auto url_str = std::string(ctx.parser.get().target());
-        auto [tgt_str, param_str] = split_left(url_str, "?");
-        auto verb = convert_boost_verb(ctx.parser.get().method());
-        PLAI_DEBUG(
-            "transfer encoding: {}",
-            std::string_view(ctx.parser.get()[http::field::transfer_encoding]));
-        if (!verb) {
-            ctx.respond(
-                {.body = "Unsupported method", .status_code = PLAI_HTTP(405)});
+        // re-arm first so other workers can accept while this one is busy
+        accept();
+        if (ec) {
+            PLAI_ERR("failed to accept a connection: '{}'", ec.message());
             return;
         }
-        for (const auto& [key, handler] : m_services) {
-            if (!(key.methods & *verb)) continue;
-            auto tgt = parse_target(key.pattern, tgt_str);
-            if (tgt) {
-                PLAI_DEBUG("handler: '{}'", key.pattern);
-                auto query_params = parse_query_params(param_str);
-                RequestImpl req{*verb, *tgt, ctx, query_params};
-                auto resp = handler(req);
-                ctx.respond(resp);
-            }
-        }
-        ctx.respond({.body = "Not found", .status_code = PLAI_HTTP(404)});
+        std::make_shared<Session>(
+            std::move(sock), m_routes,
+            m_concurrent_handlers ? nullptr : &m_handler_mut, m_idle_timeout)
+            ->start();
     }
 
     fs::path m_sock;
     boost::asio::io_context m_ioc{};
     local::stream_protocol::acceptor m_acceptor{m_ioc};
-    ServiceMap m_services;
+    Routes m_routes;
+    size_t m_threads;
+    bool m_concurrent_handlers;
+    std::mutex m_handler_mut{};
+    Duration m_idle_timeout;
 };
 
 Server::Server(std::unique_ptr<Impl> impl) : m_impl(std::move(impl)) {}
@@ -262,23 +465,36 @@ class ServerBuilder::Impl {
 
     void bind(std::string socket) { m_sock = std::move(socket); }
 
+    void threads(size_t count) { m_threads = count; }
+
+    void concurrent_handlers(bool val) { m_concurrent_handlers = val; }
+
+    void idle_timeout(Duration timeout) { m_idle_timeout = timeout; }
+
     void service(std::string pattern, Method methods,
                  std::function<Response(const Request&)> handler) {
         m_services[{std::move(pattern), methods}] = std::move(handler);
     }
 
     Server commit() {
-        ServiceMap processed{};
+        Routes routes{};
         for (auto&& [key, val] : m_services) {
-            processed[{m_prefix + key.pattern, key.methods}] = std::move(val);
+            auto pattern = m_prefix + key.pattern;
+            routes.router.add(pattern, key.methods, routes.services.size());
+            routes.services.push_back({std::move(pattern), std::move(val)});
         }
         return {std::make_unique<Server::Impl>(std::move(m_sock),
-                                               std::move(processed))};
+                                               std::move(routes), m_threads,
+                                               m_concurrent_handlers,
+                                               m_idle_timeout)};
     }
 
  private:
     std::string m_prefix{};
     std::string m_sock{};
+    size_t m_threads{DEFAULT_THREADS};
+    bool m_concurrent_handlers{};
+    Duration m_idle_timeout{DEFAULT_IDLE_TIMEOUT};
     ServiceMap m_services{};
 };
 
@@ -294,6 +510,21 @@ auto ServerBuilder::bind(std::string socket) -> Self& {
     m_impl->bind(std::move(socket));
     return *this;
 }
+auto ServerBuilder::threads(size_t count) -> Self& {
+    m_impl->threads(count);
+    return *this;
+}
+
+auto ServerBuilder::concurrent_handlers(bool val) -> Self& {
+    m_impl->concurrent_handlers(val);
+    return *this;
+}
+
+auto ServerBuilder::idle_timeout(Duration timeout) -> Self& {
+    m_impl->idle_timeout(timeout);
+    return *this;
+}
+
 auto ServerBuilder::service(std::string pattern, Method methods,
                             std::function<Response(const Request&)> handler)
     -> Self& {
@@ -19,7 +19,7 @@ std::optional<Target> parse_target(std::string_view pattern,
             p.remove_prefix(1);
             if (!p.ends_with('}')) throw ValueError("invalid pattern");
             p.remove_suffix(1);
-            params[p] = t;
+            params.set(p, t);
         } else if (p != t) {
             return std::nullopt;
         }
@@ -42,7 +42,7 @@ void MediaProcessor::work(std::stop_token st) {
         try {
             auto media = m_in->next_media();
             PLAI_DEBUG("Processing next media");
-            auto demux = media::Demux(media.data());
+            auto demux = media::Demux(media);
             auto [stream_idx, stream] = demux.best_video_stream();
             bool still = stream.is_still_image();
             PLAI_TRACE("Publishing new media meta");
@@ -1,5 +1,7 @@
+#include <atomic>
 #include <plai/logs/logs.hpp>
 #include <plai/play/player.hpp>
+#include <plai/util/defer.hpp>
 #include <plai/util/match.hpp>
 #include <variant>
 
@@ -99,6 +101,10 @@ class Player::Impl final : MediaProcessor::Input, MediaProcessor::Output {
         PLAI_WARN("clear_media_queue has been deprecated");
     }
 
+    bool showing_image() const noexcept {
+        return m_showing_image.load(std::memory_order_relaxed);
+    }
+
  private:
     // MediaProcessor::Input
     media::Media next_media() override {
@@ -226,6 +232,10 @@ class Player::Impl final : MediaProcessor::Input, MediaProcessor::Output {
 
     void do_image_delay() {
         PLAI_TRACE("showing image");
+        m_showing_image.store(true, std::memory_order_relaxed);
+        auto reset = Defer([&] {
+            m_showing_image.store(false, std::memory_order_relaxed);
+        });
         auto start = Clock::now();
         auto end = start + m_opts.image_dur;
 
@@ -270,6 +280,7 @@ class Player::Impl final : MediaProcessor::Input, MediaProcessor::Output {
     size_t m_frame_count{};
     bool m_exiting{false};
     bool m_still{false};
+    std::atomic<bool> m_showing_image{false};
 };
 
 Player::Player(Frontend* front, MediaSrc* media_src, PlayerOpts opts)
@@ -279,5 +290,6 @@ Player::~Player() {}
 void Player::run() { m_impl->run(); }
 void Player::stop() { m_impl->stop(); }
 void Player::clear_media_queue() { m_impl->clear_media_queue(); }
+bool Player::showing_image() const noexcept { return m_impl->showing_image(); }
 
 }  // namespace plai::play
@@ -0,0 +1,261 @@
+#include <pthread.h>
+#include <sched.h>
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <plai/exceptions.hpp>
+#include <plai/format.hpp>
+#include <plai/sched/steal_pool.hpp>
+#include <thread>
+#include <vector>
+
+namespace plai::sched {
+namespace {
+
+/**
+ * \brief CPUs the process may run on, in ascending order
+ * */
+std::vector<int> allowed_cpus() {
+    cpu_set_t set{};
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set)) {
+        throw ValueError(format("sched_getaffinity: {}", strerror(errno)));
+    }
+    std::vector<int> out{};
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &set)) out.push_back(cpu);
+    }
+    return out;
+}
+
+void pin_thread(std::thread& thread, int cpu) {
+    cpu_set_t set{};
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    auto res =
+        pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+    if (res) {
+        throw ValueError(
+            format("pthread_setaffinity_np: {}", strerror(res)));
+    }
+}
+
+}  // namespace
+
+class StealPool::Impl {
+    struct Worker {
+        std::mutex mut{};
+        std::deque<Fn> queue{};
+    };
+
+ public:
+    explicit Impl(StealPoolOpts opts) {
+        auto cpus = allowed_cpus();
+        auto n =
+            opts.threads ? opts.threads : std::max<size_t>(1, cpus.size());
+        m_workers.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            m_workers.push_back(std::make_unique<Worker>());
+        }
+        m_threads.reserve(n);
+        try {
+            for (size_t i = 0; i < n; ++i) {
+                m_threads.emplace_back([this, i] { run(i); });
+                if (opts.pin && !cpus.empty()) {
+                    pin_thread(m_threads.back(), cpus[i % cpus.size()]);
+                }
+            }
+        } catch (...) {
+            stop();
+            join_threads();
+            throw;
+        }
+    }
+
+    ~Impl() {
+        stop();
+        join_threads();
+    }
+
+    size_t size() const noexcept { return m_workers.size(); }
+
+    void submit(Fn fn) {
+        work_started();
+        auto& worker = t_pool == this
+                           ? *m_workers[t_worker]
+                           : *m_workers[m_next.fetch_add(
+                                            1, std::memory_order_relaxed) %
+                                        m_workers.size()];
+        {
+            auto lk = std::lock_guard(worker.mut);
+            worker.queue.push_back(std::move(fn));
+        }
+        m_queued.fetch_add(1);
+        if (m_sleeping.load() > 0) {
+            auto lk = std::lock_guard(m_sleep_mut);
+            m_wakeup.notify_one();
+        }
+    }
+
+    void work_started() noexcept { m_work.fetch_add(1); }
+
+    void work_finished() noexcept {
+        if (m_work.fetch_sub(1) == 1 && m_joining.load()) {
+            auto lk = std::lock_guard(m_sleep_mut);
+            m_wakeup.notify_all();
+        }
+    }
+
+    bool running_in_this_thread() const noexcept { return t_pool == this; }
+
+    void stop() {
+        auto lk = std::lock_guard(m_sleep_mut);
+        m_stop = true;
+        m_wakeup.notify_all();
+    }
+
+    void join() {
+        {
+            auto lk = std::lock_guard(m_sleep_mut);
+            m_joining = true;
+            m_wakeup.notify_all();
+        }
+        join_threads();
+    }
+
+    /**
+     * \brief Destroy queued work, only once the workers have exited
+     * */
+    void clear() {
+        for (auto& worker : m_workers) {
+            auto queue = std::deque<Fn>();
+            {
+                auto lk = std::lock_guard(worker->mut);
+                std::swap(queue, worker->queue);
+            }
+        }
+    }
+
+    void join_threads() {
+        for (auto& t : m_threads) {
+            if (t.joinable() && t.get_id() != std::this_thread::get_id()) {
+                t.join();
+            }
+        }
+    }
+
+ private:
+    bool done() const noexcept {
+        return m_stop.load() || (m_joining.load() && m_work.load() == 0);
+    }
+
+    void run(size_t idx) {
+        t_pool = this;
+        t_worker = idx;
+        while (true) {
+            auto fn = pop(idx);
+            if (!fn) fn = steal(idx);
+            if (fn) {
+                m_queued.fetch_sub(1);
+                fn();
+                fn = nullptr;
+                work_finished();
+                if (m_stop.load()) return;
+                continue;
+            }
+            auto lk = std::unique_lock(m_sleep_mut);
+            if (done()) return;
+            m_sleeping.fetch_add(1);
+            m_wakeup.wait(lk, [&] { return m_queued.load() > 0 || done(); });
+            m_sleeping.fetch_sub(1);
+            if (done()) return;
+        }
+    }
+
+    Fn pop(size_t idx) {
+        auto& worker = *m_workers[idx];
+        auto lk = std::lock_guard(worker.mut);
+        if (worker.queue.empty()) return nullptr;
+        auto out = std::move(worker.queue.front());
+        worker.queue.pop_front();
+        return out;
+    }
+
+    /**
+     * \brief Take half of the queue of the first worker that has work
+     * */
+    Fn steal(size_t idx) {
+        std::vector<Fn> stolen{};
+        for (size_t i = 1; i < m_workers.size() && stolen.empty(); ++i) {
+            auto& victim = *m_workers[(idx + i) % m_workers.size()];
+            auto lk = std::lock_guard(victim.mut);
+            auto count = (victim.queue.size() + 1) / 2;
+            for (size_t j = 0; j < count; ++j) {
+                stolen.push_back(std::move(victim.queue.front()));
+                victim.queue.pop_front();
+            }
+        }
+        if (stolen.empty()) return nullptr;
+        if (stolen.size() > 1) {
+            auto& worker = *m_workers[idx];
+            auto lk = std::lock_guard(worker.mut);
+            for (size_t i = 1; i < stolen.size(); ++i) {
+                worker.queue.push_back(std::move(stolen[i]));
+            }
+        }
+        return std::move(stolen.front());
+    }
+
+    static thread_local Impl* t_pool;
+    static thread_local size_t t_worker;
+
+    std::vector<std::unique_ptr<Worker>> m_workers{};
+    std::vector<std::thread> m_threads{};
+    std::atomic<size_t> m_next{0};
+    // tasks in the queues
+    std::atomic<size_t> m_queued{0};
+    // tasks queued or running plus tracked executors
+    std::atomic<size_t> m_work{0};
+    std::atomic<size_t> m_sleeping{0};
+    std::atomic<bool> m_stop{false};
+    std::atomic<bool> m_joining{false};
+    std::mutex m_sleep_mut{};
+    std::condition_variable m_wakeup{};
+};
+
+thread_local StealPool::Impl* StealPool::Impl::t_pool{};
+thread_local size_t StealPool::Impl::t_worker{};
+
+StealPool::StealPool(StealPoolOpts opts)
+    : m_impl(std::make_unique<Impl>(opts)) {}
+
+StealPool::~StealPool() {
+    m_impl->stop();
+    m_impl->join_threads();
+    // services like the timer scheduler may still post to the pool
+    shutdown();
+    m_impl->clear();
+    destroy();
+}
+
+size_t StealPool::size() const noexcept { return m_impl->size(); }
+
+void StealPool::stop() { m_impl->stop(); }
+
+void StealPool::join() { m_impl->join(); }
+
+void StealPool::submit(Fn fn) { m_impl->submit(std::move(fn)); }
+
+void StealPool::work_started() noexcept { m_impl->work_started(); }
+
+void StealPool::work_finished() noexcept { m_impl->work_finished(); }
+
+bool StealPool::running_in_this_thread() const noexcept {
+    return m_impl->running_in_this_thread();
+}
+
+}  // namespace plai::sched
@@ -6,6 +6,7 @@
 #include <plai/c_str.hpp>
 #include <plai/crypto.hpp>
 #include <plai/exceptions.hpp>
+#include <plai/util/defer.hpp>
 #include <ranges>
 #include <vector>
 
@@ -17,15 +18,15 @@ class SqliteException : public Exception {
     SqliteException(CStr str) : Exception(str) {}
 };
 
-void check_error(int code, sqlite3* handle) {
+inline void check_error(int code, sqlite3* handle) {
     if (code != SQLITE_OK) throw SqliteException(handle);
 }
 
 using Connection = std::unique_ptr<sqlite3, int (*)(sqlite3*)>;
-inline Connection connect(CStr path) {
+inline Connection connect(
+    CStr path, int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE) {
     sqlite3* handle{};
-    auto res = sqlite3_open_v2(
-        path, &handle, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr);
+    auto res = sqlite3_open_v2(path, &handle, flags, nullptr);
     if (!handle) throw std::bad_alloc();
     auto conn = Connection(handle, &sqlite3_close);
     check_error(res, handle);
@@ -40,10 +41,28 @@ inline Statement statement(sqlite3* db, CStr stmt) {
     return {s, &sqlite3_finalize};
 }
 
+/**
+ * \brief Reset a statement for reuse and clear its bindings
+ * */
+inline void reset(Statement& stmt) noexcept {
+    sqlite3_reset(stmt.get());
+    sqlite3_clear_bindings(stmt.get());
+}
+
+/**
+ * \brief Use a cached statement, resetting it at the end of the scope
+ *
+ * Resetting right away also ends the read transaction of a statement that
+ * was not stepped to completion instead of keeping it open until next use.
+ * */
+[[nodiscard]] inline auto use(Statement& stmt) noexcept {
+    return Defer([&stmt] { reset(stmt); });
+}
+
 inline void bind(Connection& conn, Statement& stmt, int idx,
                  std::span<const uint8_t> blob) {
-    int res = sqlite3_bind_blob64(stmt.get(), idx, blob.data(),
-                                  static_cast<int>(blob.size()), SQLITE_STATIC);
+    int res = sqlite3_bind_blob64(stmt.get(), idx, blob.data(), blob.size(),
+                                  SQLITE_STATIC);
     check_error(res, conn.get());
 }
 
@@ -77,8 +96,9 @@ template <class T>
 T unbind(Connection& conn, Statement& stmt, int idx);
 
 template <>
-std::vector<uint8_t> unbind<std::vector<uint8_t>>(Connection& conn,
-                                                  Statement& stmt, int idx) {
+inline std::vector<uint8_t> unbind<std::vector<uint8_t>>(Connection& conn,
+                                                         Statement& stmt,
+                                                         int idx) {
     const void* ptr = sqlite3_column_blob(stmt.get(), idx);
     const auto bytes = sqlite3_column_bytes(stmt.get(), idx);
     auto span =
@@ -87,8 +107,8 @@ std::vector<uint8_t> unbind<std::vector<uint8_t>>(Connection& conn,
 }
 
 template <>
-crypto::Sha256 unbind<crypto::Sha256>(Connection& conn, Statement& stmt,
-                                      int idx) {
+inline crypto::Sha256 unbind<crypto::Sha256>(Connection& conn,
+                                             Statement& stmt, int idx) {
     const void* ptr = sqlite3_column_blob(stmt.get(), idx);
     const auto bytes = sqlite3_column_bytes(stmt.get(), idx);
     static constexpr size_t expected_size = crypto::Sha256().size();
@@ -104,7 +124,8 @@ crypto::Sha256 unbind<crypto::Sha256>(Connection& conn, Statement& stmt,
 }
 
 template <>
-std::string unbind<std::string>(Connection& conn, Statement& stmt, int idx) {
+inline std::string unbind<std::string>(Connection& conn, Statement& stmt,
+                                        int idx) {
     const uint8_t* str = sqlite3_column_text(stmt.get(), idx);
     const auto bytes = sqlite3_column_bytes(stmt.get(), idx);
     // NOLINTNEXTLINE
@@ -112,7 +133,7 @@ std::string unbind<std::string>(Connection& conn, Statement& stmt, int idx) {
 }
 
 template <>
-int64_t unbind<int64_t>(Connection& conn, Statement& stmt, int idx) {
+inline int64_t unbind<int64_t>(Connection& conn, Statement& stmt, int idx) {
     return sqlite3_column_int64(stmt.get(), idx);
 }
 
@@ -147,4 +168,66 @@ inline void step_all(Connection& conn, Statement& stmt) {
     }
 }
 
+/**
+ * \brief Run a statement without parameters or results
+ * */
+inline void exec(Connection& conn, CStr stmt) {
+    auto s = statement(conn.get(), stmt);
+    step_all(conn, s);
+}
+
+/**
+ * \brief Run several statements separated by semicolons
+ * */
+inline void exec_script(Connection& conn, CStr script) {
+    char* err{};
+    int res = sqlite3_exec(conn.get(), script, nullptr, nullptr, &err);
+    if (res == SQLITE_OK) return;
+    auto ex = SqliteException(err ? CStr(err) : CStr("script failed"));
+    sqlite3_free(err);
+    throw ex;
+}
+
+/**
+ * \brief Roll back the open transaction, if any
+ *
+ * Safe to call while unwinding. SQLite rolls back on its own after some
+ * errors, e.g. SQLITE_FULL, and a ROLLBACK that fails anyway is ignored.
+ * */
+inline void rollback(Connection& conn) noexcept {
+    if (sqlite3_get_autocommit(conn.get())) return;
+    sqlite3_exec(conn.get(), "ROLLBACK;", nullptr, nullptr, nullptr);
+}
+
+using Blob = std::unique_ptr<sqlite3_blob, int (*)(sqlite3_blob*)>;
+
+/**
+ * \brief Open a handle for incremental I/O on a single blob
+ * */
+inline Blob open_blob(Connection& conn, CStr table, CStr column, int64_t rowid,
+                      bool writable) {
+    sqlite3_blob* b{};
+    int res = sqlite3_blob_open(conn.get(), "main", table, column, rowid,
+                                writable ? 1 : 0, &b);
+    auto blob = Blob(b, &sqlite3_blob_close);
+    check_error(res, conn.get());
+    return blob;
+}
+
+inline void write_blob(Connection& conn, Blob& blob,
+                       std::span<const uint8_t> data, size_t offset) {
+    int res = sqlite3_blob_write(blob.get(), data.data(),
+                                 static_cast<int>(data.size()),
+                                 static_cast<int>(offset));
+    check_error(res, conn.get());
+}
+
+inline void read_blob(Connection& conn, Blob& blob, std::span<uint8_t> out,
+                      size_t offset) {
+    int res = sqlite3_blob_read(blob.get(), out.data(),
+                                static_cast<int>(out.size()),
+                                static_cast<int>(offset));
+    check_error(res, conn.get());
+}
+
 }  // namespace plai::sqlite
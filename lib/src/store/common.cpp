@@ -0,0 +1,285 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <optional>
+#include <plai/format.hpp>
+#include <plai/logs/logs.hpp>
+#include <plai/util/defer.hpp>
+#include <system_error>
+
+#include "store/common.hpp"
+
+namespace plai::store_detail {
+namespace {
+
+// Size the WAL is truncated to after a checkpoint, it is not shrunk at all
+// otherwise
+constexpr int64_t JOURNAL_SIZE_LIMIT = 64 * 1024 * 1024;
+
+std::string_view synchronous_str(SqliteOpts::Synchronous sync) {
+    switch (sync) {
+        case SqliteOpts::Synchronous::Off: return "OFF";
+        case SqliteOpts::Synchronous::Normal: return "NORMAL";
+        case SqliteOpts::Synchronous::Full: return "FULL";
+    }
+    return "FULL";
+}
+
+/**
+ * \brief First column of the single row `sql` returns
+ * */
+int64_t query_value(sqlite::Connection& conn, const std::string& sql) {
+    auto stmt = sqlite::statement(conn.get(), sql);
+    if (sqlite::step_one(conn, stmt) != SQLITE_ROW)
+        throw sqlite::SqliteException(plai::format("no result for {}", sql));
+    return sqlite::unbind<int64_t>(conn, stmt, 0);
+}
+
+int64_t pragma_value(sqlite::Connection& conn, std::string_view name) {
+    return query_value(conn, plai::format("PRAGMA {};", name));
+}
+
+int64_t schema_version(sqlite::Connection& conn) {
+    return pragma_value(conn, "user_version");
+}
+
+/**
+ * \brief Bytes needed to write a second copy of the database
+ *
+ * Migrations that rewrite the payloads write the new copy through the WAL
+ * before the old one is freed.
+ * */
+uintmax_t copy_space_needed(sqlite::Connection& conn) {
+    return 2 * static_cast<uintmax_t>(pragma_value(conn, "page_count") *
+                                      pragma_value(conn, "page_size"));
+}
+
+/**
+ * \brief Free bytes on the file system of the database
+ *
+ * \return std::nullopt if it can not be determined
+ * */
+std::optional<uintmax_t> free_space(CStr path) {
+    std::error_code ec{};
+    const auto space = std::filesystem::space(
+        std::filesystem::absolute(path.view()).parent_path(), ec);
+    if (ec) {
+        PLAI_WARN("failed to get the free space for the store database: {}",
+                  ec.message());
+        return std::nullopt;
+    }
+    return space.available;
+}
+
+/**
+ * \brief Whether the file system of the database has room for a VACUUM
+ *
+ * VACUUM writes a copy of the database to a temporary file and then copies
+ * it back through the WAL.
+ * */
+bool has_space_for_vacuum(sqlite::Connection& conn, CStr path) {
+    const auto needed = copy_space_needed(conn);
+    const auto available = free_space(path);
+    if (!available) return false;
+    if (*available >= needed) return true;
+    PLAI_WARN("not rebuilding the store database, {} MiB needed but only {} "
+              "MiB free",
+              needed >> 20, *available >> 20);
+    return false;
+}
+
+/**
+ * \brief Switch the database to incremental auto vacuum
+ *
+ * The mode can only be changed by rebuilding the database with VACUUM. That
+ * is cheap for a new one, but takes long for one full of media, so existing
+ * databases are only rebuilt if `opts` asks for it.
+ * */
+void enable_incremental_vacuum(sqlite::Connection& conn, CStr path,
+                               const SqliteOpts& opts) {
+    constexpr int64_t INCREMENTAL = 2;
+    if (pragma_value(conn, "auto_vacuum") == INCREMENTAL) return;
+    if (query_value(conn, "SELECT count(*) FROM sqlite_master;") > 0) {
+        if (!opts.rebuild_for_compaction) {
+            PLAI_INFO("the store database can not be compacted until it is "
+                      "rebuilt once");
+            return;
+        }
+        if (!has_space_for_vacuum(conn, path)) return;
+        PLAI_INFO("rebuilding the store database for compaction");
+    }
+    sqlite::exec(conn, "PRAGMA auto_vacuum=INCREMENTAL;");
+    sqlite::exec(conn, "VACUUM;");
+}
+
+/**
+ * \brief Apply the per connection cache settings
+ * */
+void set_cache_opts(sqlite::Connection& conn, const SqliteOpts& opts) {
+    sqlite::exec(conn, plai::format("PRAGMA mmap_size={};", opts.mmap_size));
+    // negative values are in KiB rather than pages
+    sqlite::exec(conn,
+                 plai::format("PRAGMA cache_size=-{};", opts.cache_size_kib));
+}
+
+/**
+ * \brief Bring the schema up to date in a single transaction
+ *
+ * Migrations may rewrite every payload, so they are refused rather than
+ * left to fail with SQLITE_FULL halfway if there is not enough free space.
+ * */
+void migrate(sqlite::Connection& conn, CStr path,
+             std::span<const CStr> migrations) {
+    sqlite::exec(conn, "BEGIN IMMEDIATE;");
+    auto rollback = Defer([&] { sqlite::rollback(conn); });
+    const auto from = schema_version(conn);
+    const auto to = static_cast<int64_t>(migrations.size());
+    if (from > to) {
+        throw ValueError(plai::format(
+            "database schema version {} is newer than supported {}", from,
+            to));
+    }
+    if (from == to) return;
+    const auto needed = copy_space_needed(conn);
+    const auto available = free_space(path);
+    if (available && *available < needed) {
+        throw ValueError(plai::format(
+            "migrating the store database from schema version {} needs {} "
+            "MiB free space but only {} MiB are available",
+            from, needed >> 20, *available >> 20));
+    }
+    for (auto v = from; v < to; ++v) {
+        PLAI_INFO("migrating store schema from version {} to {}", v, v + 1);
+        sqlite::exec_script(conn, migrations[v]);
+    }
+    sqlite::exec(conn, plai::format("PRAGMA user_version={};", to));
+    sqlite::exec(conn, "COMMIT;");
+    rollback.cancel();
+}
+
+}  // namespace
+
+Fd::~Fd() {
+    if (m_fd >= 0) ::close(m_fd);
+}
+
+void throw_errno(std::string_view what, const std::filesystem::path& path) {
+    throw std::system_error(errno, std::generic_category(),
+                            plai::format("{} '{}'", what, path.native()));
+}
+
+Fd open_file(const std::filesystem::path& path, int flags) {
+    // NOLINTNEXTLINE
+    auto fd = Fd(::open(path.c_str(), flags | O_CLOEXEC, 0644));
+    if (fd.get() < 0) throw_errno("failed to open", path);
+    return fd;
+}
+
+std::pair<std::filesystem::path, Fd> temp_file(
+    const std::filesystem::path& dir) {
+    auto tmpl = (dir / "upload-XXXXXX").string();
+    // NOLINTNEXTLINE
+    auto fd = Fd(::mkostemp(tmpl.data(), O_CLOEXEC));
+    if (fd.get() < 0) throw_errno("failed to create", tmpl);
+    return {std::filesystem::path(std::move(tmpl)), std::move(fd)};
+}
+
+void write_all(const Fd& fd, std::span<const uint8_t> data,
+               const std::filesystem::path& path) {
+    while (!data.empty()) {
+        auto res = ::write(fd.get(), data.data(), data.size());
+        if (res < 0 && errno == EINTR) continue;
+        if (res < 0) throw_errno("failed to write", path);
+        data = data.subspan(static_cast<size_t>(res));
+    }
+}
+
+void read_all(const Fd& fd, std::span<uint8_t> out, int64_t offset,
+              const std::filesystem::path& path) {
+    while (!out.empty()) {
+        auto res = ::pread(fd.get(), out.data(), out.size(), offset);
+        if (res < 0 && errno == EINTR) continue;
+        if (res < 0) throw_errno("failed to read", path);
+        if (res == 0)
+            throw ValueError(
+                plai::format("unexpected end of '{}'", path.native()));
+        out = out.subspan(static_cast<size_t>(res));
+        offset += res;
+    }
+}
+
+void sync_file(const Fd& fd, const std::filesystem::path& path) {
+    if (::fsync(fd.get()) < 0) throw_errno("failed to sync", path);
+}
+
+Hasher make_hasher(size_t size) {
+    if (size >= BACKGROUND_HASH_MIN_SIZE)
+        return Hasher(std::in_place_type<crypto::BackgroundSha256Hasher>);
+    return Hasher(std::in_place_type<crypto::Sha256Hasher>);
+}
+
+std::vector<crypto::Sha256> digests_of(std::span<const StoreItem> items) {
+    std::vector<crypto::Sha256> out{};
+    out.reserve(items.size());
+    for (const auto& item : items) {
+        out.push_back(item.digest ? *item.digest : crypto::sha256(item.blob));
+    }
+    return out;
+}
+
+sqlite::Connection open_db(CStr path, const SqliteOpts& opts,
+                           std::span<const CStr> migrations) {
+    auto conn = sqlite::connect(path);
+    sqlite::exec(conn, "PRAGMA journal_mode=WAL;");
+    sqlite::exec(conn, plai::format("PRAGMA journal_size_limit={};",
+                                    JOURNAL_SIZE_LIMIT));
+    sqlite::exec(conn, plai::format("PRAGMA synchronous={};",
+                                    synchronous_str(opts.synchronous)));
+    set_cache_opts(conn, opts);
+    enable_incremental_vacuum(conn, path, opts);
+    migrate(conn, path, migrations);
+    return conn;
+}
+
+sqlite::Connection open_reader(CStr path, const SqliteOpts& opts) {
+    auto conn = sqlite::connect(path, SQLITE_OPEN_READONLY);
+    set_cache_opts(conn, opts);
+    return conn;
+}
+
+CompactStats incremental_vacuum(sqlite::Connection& conn, size_t max_pages) {
+    const auto before =
+        static_cast<size_t>(pragma_value(conn, "freelist_count"));
+    // 0 would free all pages
+    if (before && max_pages) {
+        sqlite::exec(conn, plai::format("PRAGMA incremental_vacuum({});",
+                                        max_pages));
+    }
+    const auto after =
+        static_cast<size_t>(pragma_value(conn, "freelist_count"));
+    return {.freed_pages = before - after,
+            .free_pages = after,
+            .page_size = static_cast<size_t>(pragma_value(conn, "page_size"))};
+}
+
+LockResult set_locked(sqlite::Connection& conn, sqlite::Statement& stmt,
+                      std::span<CStr> keys, bool locked) {
+    sqlite::exec(conn, "BEGIN IMMEDIATE;");
+    auto rollback = Defer([&] { sqlite::rollback(conn); });
+    LockResult res{};
+    for (const auto& key : keys) {
+        auto reset = sqlite::use(stmt);
+        sqlite::bind_all(conn, stmt, int64_t{locked}, key);
+        sqlite::step_all(conn, stmt);
+        if (sqlite3_changes(conn.get()) == 0) {
+            res.missing.emplace_back(key.view());
+        }
+    }
+    if (locked && !res) return res;
+    sqlite::exec(conn, "COMMIT;");
+    rollback.cancel();
+    return res;
+}
+
+}  // namespace plai::store_detail
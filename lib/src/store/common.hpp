@@ -0,0 +1,116 @@
+#pragma once
+
+#include <filesystem>
+#include <plai/c_str.hpp>
+#include <plai/crypto.hpp>
+#include <plai/store.hpp>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "sqlite.hpp"
+
+/**
+ * \brief Pieces shared by the Store implementations
+ * */
+namespace plai::store_detail {
+
+// Uploads at least this big are hashed on a separate thread
+constexpr size_t BACKGROUND_HASH_MIN_SIZE = 16 * 1024 * 1024;
+
+using Hasher =
+    std::variant<crypto::Sha256Hasher, crypto::BackgroundSha256Hasher>;
+
+Hasher make_hasher(size_t size);
+
+/**
+ * \brief Owned file descriptor
+ * */
+class Fd {
+ public:
+    explicit Fd(int fd = -1) noexcept : m_fd(fd) {}
+
+    Fd(const Fd&) = delete;
+    Fd& operator=(const Fd&) = delete;
+
+    Fd(Fd&& other) noexcept : m_fd(std::exchange(other.m_fd, -1)) {}
+
+    Fd& operator=(Fd&& other) noexcept {
+        auto tmp = Fd(std::move(other));
+        std::swap(m_fd, tmp.m_fd);
+        return *this;
+    }
+
+    ~Fd();
+
+    int get() const noexcept { return m_fd; }
+
+ private:
+    int m_fd;
+};
+
+/**
+ * \brief Throw std::system_error for errno
+ * */
+[[noreturn]] void throw_errno(std::string_view what,
+                              const std::filesystem::path& path);
+
+Fd open_file(const std::filesystem::path& path, int flags);
+
+/**
+ * \brief Create a new file with a unique name in `dir`
+ * */
+std::pair<std::filesystem::path, Fd> temp_file(
+    const std::filesystem::path& dir);
+
+void write_all(const Fd& fd, std::span<const uint8_t> data,
+               const std::filesystem::path& path);
+
+/**
+ * \brief Fill `out` from `offset` on
+ *
+ * \throw ValueError if the file ends before
+ * */
+void read_all(const Fd& fd, std::span<uint8_t> out, int64_t offset,
+              const std::filesystem::path& path);
+
+void sync_file(const Fd& fd, const std::filesystem::path& path);
+
+/**
+ * \brief Digests of `items`, calculated in order where they are missing
+ * */
+std::vector<crypto::Sha256> digests_of(std::span<const StoreItem> items);
+
+/**
+ * \brief Open a SQLite database in WAL mode and bring its schema up to date
+ *
+ * \param migrations Scripts migrating the schema, the one at index N
+ * upgrades from PRAGMA user_version N to N + 1.
+ * */
+sqlite::Connection open_db(CStr path, const SqliteOpts& opts,
+                           std::span<const CStr> migrations);
+
+/**
+ * \brief Open a read-only connection to a database created by open_db()
+ * */
+sqlite::Connection open_reader(CStr path, const SqliteOpts& opts);
+
+/**
+ * \brief Free up to `max_pages` pages of a database created by open_db()
+ * */
+CompactStats incremental_vacuum(sqlite::Connection& conn, size_t max_pages);
+
+/**
+ * \brief Set the locked flag of `keys` in a single transaction
+ *
+ * Runs `stmt`, which takes the flag and a key as parameters, once per key.
+ * When locking fails because of missing keys, no key is locked. Missing keys
+ * are ignored when unlocking.
+ * */
+LockResult set_locked(sqlite::Connection& conn, sqlite::Statement& stmt,
+                      std::span<CStr> keys, bool locked);
+
+}  // namespace plai::store_detail
@@ -0,0 +1,42 @@
+#include <plai/logs/logs.hpp>
+#include <plai/store_compactor.hpp>
+#include <plai/util/memfn.hpp>
+
+namespace plai {
+
+StoreCompactor::StoreCompactor(Store& store, sched::Executor exec,
+                               std::function<bool()> idle,
+                               CompactorOpts opts)
+    : m_store(&store),
+      m_idle(std::move(idle)),
+      m_pages_per_step(opts.pages_per_step),
+      m_task(sched::task() | sched::period(opts.period) |
+             sched::executor(std::move(exec)) |
+             memfn(this, &StoreCompactor::step) | sched::task_finish()) {}
+
+StoreCompactor::Metrics StoreCompactor::metrics() const noexcept {
+    return {.steps = m_steps.load(std::memory_order_relaxed),
+            .freed_pages = m_freed_pages.load(std::memory_order_relaxed),
+            .freed_bytes = m_freed_bytes.load(std::memory_order_relaxed),
+            .free_pages = m_free_pages.load(std::memory_order_relaxed)};
+}
+
+void StoreCompactor::step() {
+    if (m_idle && !m_idle()) return;
+    try {
+        auto stats = m_store->compact(m_pages_per_step);
+        m_steps.fetch_add(1, std::memory_order_relaxed);
+        m_freed_pages.fetch_add(stats.freed_pages, std::memory_order_relaxed);
+        m_freed_bytes.fetch_add(stats.freed_pages * stats.page_size,
+                                std::memory_order_relaxed);
+        m_free_pages.store(stats.free_pages, std::memory_order_relaxed);
+        if (stats.freed_pages) {
+            PLAI_DEBUG("compacted store: freed {} pages, {} left",
+                       stats.freed_pages, stats.free_pages);
+        }
+    } catch (const std::exception& e) {
+        PLAI_ERR("failed to compact store: {}", e.what());
+    }
+}
+
+}  // namespace plai
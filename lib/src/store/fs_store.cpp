@@ -0,0 +1,522 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cerrno>
+#include <filesystem>
+#include <mutex>
+#include <plai/crypto.hpp>
+#include <plai/format.hpp>
+#include <plai/logs/logs.hpp>
+#include <plai/store.hpp>
+#include <plai/util/defer.hpp>
+#include <plai/util/match.hpp>
+
+#include "sqlite.hpp"
+#include "store/common.hpp"
+
+namespace plai {
+namespace {
+namespace stdfs = std::filesystem;
+using store_detail::Fd;
+using store_detail::open_file;
+using store_detail::read_all;
+using store_detail::sync_file;
+using store_detail::throw_errno;
+using store_detail::write_all;
+
+constexpr std::array<CStr, 1> migrations = {
+    "CREATE TABLE media (name TEXT PRIMARY KEY, sha256 BLOB NOT NULL, "
+    "bytes INTEGER, locked BOOLEAN, marked_for_deletion BOOLEAN) "
+    "WITHOUT ROWID;"
+    "CREATE INDEX media_sha256 ON media (sha256);",
+};
+
+constexpr CStr list_stmt = "SELECT name FROM media;";
+constexpr CStr upsert_media_stmt =
+    "INSERT INTO media VALUES (?,?,?,0,0) ON CONFLICT (name) DO UPDATE SET "
+    "sha256=excluded.sha256, bytes=excluded.bytes, locked=0, "
+    "marked_for_deletion=0;";
+constexpr CStr inspect_stmt =
+    "SELECT sha256, bytes, locked, marked_for_deletion FROM media WHERE "
+    "(name=?);";
+constexpr CStr digest_stmt = "SELECT sha256 FROM media WHERE name=?;";
+constexpr CStr referenced_stmt = "SELECT 1 FROM media WHERE sha256=? LIMIT 1;";
+constexpr CStr set_locked_stmt = "UPDATE media SET locked=? WHERE name=?;";
+constexpr CStr mark_for_deletion_stmt =
+    "UPDATE media SET marked_for_deletion=? WHERE name=?;";
+constexpr CStr prune_marked_stmt =
+    "DELETE FROM media WHERE (marked_for_deletion=1 AND locked=0) "
+    "RETURNING sha256;";
+
+constexpr auto INDEX_NAME = "index.db";
+constexpr auto BLOBS_DIR = "blobs";
+constexpr auto TMP_DIR = "tmp";
+
+/**
+ * \brief Statements for the fixed queries of the index
+ * */
+struct Statements {
+    explicit Statements(sqlite::Connection& conn)
+        : list(sqlite::statement(conn.get(), list_stmt)),
+          upsert_media(sqlite::statement(conn.get(), upsert_media_stmt)),
+          inspect(sqlite::statement(conn.get(), inspect_stmt)),
+          digest(sqlite::statement(conn.get(), digest_stmt)),
+          referenced(sqlite::statement(conn.get(), referenced_stmt)),
+          set_locked(sqlite::statement(conn.get(), set_locked_stmt)),
+          mark_for_deletion(
+              sqlite::statement(conn.get(), mark_for_deletion_stmt)),
+          prune_marked(sqlite::statement(conn.get(), prune_marked_stmt)) {}
+
+    sqlite::Statement list;
+    sqlite::Statement upsert_media;
+    sqlite::Statement inspect;
+    sqlite::Statement digest;
+    sqlite::Statement referenced;
+    sqlite::Statement set_locked;
+    sqlite::Statement mark_for_deletion;
+    sqlite::Statement prune_marked;
+};
+
+size_t file_size(const Fd& fd, const stdfs::path& path) {
+    struct stat st {};
+    if (::fstat(fd.get(), &st) < 0) throw_errno("failed to stat", path);
+    return static_cast<size_t>(st.st_size);
+}
+
+/**
+ * \brief Reads a payload file with pread
+ *
+ * Payload files are never modified, only deleted, so an open file keeps the
+ * data the reader started with.
+ * */
+class FsReader final : public StoreReader {
+ public:
+    FsReader(stdfs::path path, Fd fd)
+        : m_path(std::move(path)),
+          m_fd(std::move(fd)),
+          m_size(file_size(m_fd, m_path)) {}
+
+    size_t size() const noexcept override { return m_size; }
+
+    size_t read(size_t offset, std::span<uint8_t> out) override {
+        if (offset >= m_size) return 0;
+        out = out.subspan(0, std::min(out.size(), m_size - offset));
+        read_all(m_fd, out, static_cast<int64_t>(offset), m_path);
+        return out.size();
+    }
+
+ private:
+    stdfs::path m_path;
+    Fd m_fd;
+    size_t m_size;
+};
+
+}  // namespace
+
+/**
+ * \brief Store keeping payloads as individual files
+ *
+ * Metadata lives in a small SQLite index while payloads are files named by
+ * their digest, so reads bypass SQLite entirely and keys with the same
+ * content share a file. Payloads are written to a temporary file first and
+ * renamed into place once complete and verified, so a file with a digest as
+ * name always holds the matching data. Files no longer referenced by any key
+ * are deleted after the index is updated. Leftovers of a crash in between
+ * are collected when the store is opened.
+ * */
+class FsStore final : public Store {
+    friend class FsWriter;
+
+ public:
+    using Store::writer;
+
+    FsStore(const stdfs::path& dir, const SqliteOpts& opts)
+        : m_blobs(dir / BLOBS_DIR),
+          m_tmp(dir / TMP_DIR),
+          m_sync(opts.synchronous != SqliteOpts::Synchronous::Off),
+          m_conn(make_index(dir, opts)),
+          m_stmts(m_conn) {
+        stdfs::create_directories(m_blobs);
+        stdfs::create_directories(m_tmp);
+        collect_garbage();
+    }
+
+    std::vector<std::string> list() final {
+        std::lock_guard lock(m_mutex);
+        return do_list();
+    }
+
+    void store(CStr key, std::span<const uint8_t> blob) final {
+        const auto item = StoreItem{.key = key, .blob = blob};
+        store_many(std::span(&item, 1));
+    }
+
+    void store_many(std::span<const StoreItem> items) final {
+        const auto digests = store_detail::digests_of(items);
+        std::vector<Meta> metas{};
+        metas.reserve(items.size());
+        std::lock_guard lock(m_mutex);
+        bool published = false;
+        for (size_t i = 0; i < items.size(); ++i) {
+            const auto& [key, blob, _] = items[i];
+            const auto& digest = digests[i];
+            metas.push_back(
+                {.key = key, .digest = digest, .size = blob.size()});
+            if (stdfs::exists(blob_path(digest))) continue;
+            auto [path, fd] = temp_file();
+            auto remove = Defer([&] { stdfs::remove(path); });
+            write_all(fd, blob, path);
+            publish(path, fd, digest, false);
+            remove.cancel();
+            published = true;
+        }
+        if (published) sync_blobs();
+        set_meta(metas);
+    }
+
+    std::unique_ptr<StoreWriter> writer(
+        CStr key, size_t expected_size,
+        std::optional<crypto::Sha256> expected_digest) final;
+
+    std::optional<BlobMeta> link(CStr key,
+                                 const crypto::Sha256& digest) final {
+        std::lock_guard lock(m_mutex);
+        std::error_code ec{};
+        auto size = stdfs::file_size(blob_path(digest), ec);
+        if (ec) return std::nullopt;
+        set_meta(key, digest, size);
+        return do_inspect(key);
+    }
+
+    std::optional<BlobMeta> inspect(CStr key) final {
+        std::lock_guard lock(m_mutex);
+        return do_inspect(key);
+    }
+
+    LockResult lock(std::span<CStr> keys) final {
+        std::lock_guard lock(m_mutex);
+        return store_detail::set_locked(m_conn, m_stmts.set_locked, keys,
+                                        true);
+    }
+
+    void unlock(std::span<CStr> keys) final {
+        std::lock_guard lock(m_mutex);
+        store_detail::set_locked(m_conn, m_stmts.set_locked, keys, false);
+        prune_marked();
+    }
+
+    std::vector<uint8_t> read(CStr key) final {
+        auto [path, fd] = open_payload(key);
+        std::vector<uint8_t> out(file_size(fd, path));
+        read_all(fd, out, 0, path);
+        return out;
+    }
+
+    std::unique_ptr<StoreReader> reader(CStr key) final {
+        auto [path, fd] = open_payload(key);
+        return std::make_unique<FsReader>(std::move(path), std::move(fd));
+    }
+
+    void remove(CStr key) final {
+        std::lock_guard lock(m_mutex);
+        {
+            auto& stmt = m_stmts.mark_for_deletion;
+            auto reset = sqlite::use(stmt);
+            sqlite::bind_all(m_conn, stmt, 1, key);
+            sqlite::step_all(m_conn, stmt);
+        }
+        prune_marked();
+    }
+
+    CompactStats compact(size_t max_pages) final {
+        std::lock_guard lock(m_mutex);
+        return store_detail::incremental_vacuum(m_conn, max_pages);
+    }
+
+ private:
+    static sqlite::Connection make_index(const stdfs::path& dir,
+                                         const SqliteOpts& opts) {
+        stdfs::create_directories(dir);
+        auto path = (dir / INDEX_NAME).string();
+        return store_detail::open_db(path, opts, migrations);
+    }
+
+    /**
+     * \brief Open the payload file of `key`
+     * */
+    std::pair<stdfs::path, Fd> open_payload(CStr key) {
+        while (true) {
+            auto path = [&] {
+                std::lock_guard lock(m_mutex);
+                auto digest = find_digest(key);
+                if (!digest)
+                    throw ValueError(plai::format(
+                        "no data in storage matching key '{}'", key.view()));
+                return blob_path(*digest);
+            }();
+            // the file is deleted if the key is overwritten or removed once
+            // the lock is released, look it up again then. It stays readable
+            // once opened.
+            // NOLINTNEXTLINE
+            auto fd = Fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+            if (fd.get() < 0 && errno == ENOENT) continue;
+            if (fd.get() < 0) throw_errno("failed to open", path);
+            return {std::move(path), std::move(fd)};
+        }
+    }
+
+    stdfs::path blob_path(const crypto::Sha256& digest) const {
+        return m_blobs / crypto::hex_str(digest);
+    }
+
+    std::pair<stdfs::path, Fd> temp_file() const {
+        return store_detail::temp_file(m_tmp);
+    }
+
+    /**
+     * \brief Move a complete temporary file to its final location
+     *
+     * Needs the mutex. Without `sync_dir` the caller has to call sync_blobs()
+     * before the payload is referenced.
+     * */
+    void publish(const stdfs::path& tmp, const Fd& fd,
+                 const crypto::Sha256& digest, bool sync_dir = true) {
+        if (m_sync) sync_file(fd, tmp);
+        auto path = blob_path(digest);
+        stdfs::rename(tmp, path);
+        if (sync_dir) sync_blobs();
+    }
+
+    /**
+     * \brief Make renames into the payload directory durable
+     * */
+    void sync_blobs() {
+        if (m_sync) sync_file(open_file(m_blobs, O_RDONLY), m_blobs);
+    }
+
+    struct Meta {
+        CStr key;
+        crypto::Sha256 digest;
+        size_t size;
+    };
+
+    /**
+     * \brief Point `key` to the payload with `digest`
+     *
+     * Needs the mutex.
+     * */
+    void set_meta(CStr key, const crypto::Sha256& digest, size_t size) {
+        const auto meta = Meta{.key = key, .digest = digest, .size = size};
+        set_meta(std::span(&meta, 1));
+    }
+
+    /**
+     * \brief Point keys to their payloads in a single transaction
+     *
+     * Needs the mutex.
+     * */
+    void set_meta(std::span<const Meta> metas) {
+        std::vector<crypto::Sha256> replaced{};
+        sqlite::exec(m_conn, "BEGIN IMMEDIATE;");
+        auto rollback = Defer([&] { sqlite::rollback(m_conn); });
+        for (const auto& [key, digest, size] : metas) {
+            auto old = find_digest(key);
+            if (old && *old != digest) replaced.push_back(*old);
+            auto& stmt = m_stmts.upsert_media;
+            auto reset = sqlite::use(stmt);
+            sqlite::bind_all(m_conn, stmt, key, digest, size);
+            sqlite::step_all(m_conn, stmt);
+        }
+        sqlite::exec(m_conn, "COMMIT;");
+        rollback.cancel();
+        for (const auto& digest : replaced) release(digest);
+    }
+
+    std::optional<crypto::Sha256> find_digest(CStr key) {
+        auto& stmt = m_stmts.digest;
+        auto reset = sqlite::use(stmt);
+        sqlite::bind_all(m_conn, stmt, key);
+        if (sqlite::step_one(m_conn, stmt) != SQLITE_ROW) return std::nullopt;
+        return sqlite::unbind<crypto::Sha256>(m_conn, stmt, 0);
+    }
+
+    bool is_referenced(const crypto::Sha256& digest) {
+        auto& stmt = m_stmts.referenced;
+        auto reset = sqlite::use(stmt);
+        sqlite::bind_all(m_conn, stmt, digest);
+        return sqlite::step_one(m_conn, stmt) == SQLITE_ROW;
+    }
+
+    /**
+     * \brief Delete the payload file unless some key still refers to it
+     * */
+    void release(const crypto::Sha256& digest) {
+        if (is_referenced(digest)) return;
+        std::error_code ec{};
+        stdfs::remove(blob_path(digest), ec);
+        if (ec) {
+            PLAI_WARN("failed to delete payload {}: {}",
+                      crypto::hex_str(digest), ec.message());
+        }
+    }
+
+    void collect_garbage() {
+        for (const auto& e : stdfs::directory_iterator(m_tmp)) {
+            PLAI_INFO("deleting unfinished upload {}", e.path().native());
+            stdfs::remove(e.path());
+        }
+        for (const auto& e : stdfs::directory_iterator(m_blobs)) {
+            auto digest = crypto::parse_sha256(e.path().filename().native());
+            if (digest && is_referenced(*digest)) continue;
+            PLAI_INFO("deleting unreferenced payload {}", e.path().native());
+            stdfs::remove(e.path());
+        }
+    }
+
+    std::optional<BlobMeta> do_inspect(CStr key) {
+        auto& stmt = m_stmts.inspect;
+        auto reset = sqlite::use(stmt);
+        sqlite::bind_all(m_conn, stmt, key);
+        int res = SQLITE_BUSY;
+        while (res == SQLITE_BUSY) { res = sqlite::step_one(m_conn, stmt); }
+        if (res == SQLITE_DONE) return std::nullopt;
+        assert(res == SQLITE_ROW);
+        auto values =
+            sqlite::unbind_all<crypto::Sha256, int64_t, int64_t, int64_t>(
+                m_conn, stmt);
+        return BlobMeta{
+            .bytes = static_cast<size_t>(std::move(std::get<1>(values))),
+            .sha256 = std::move(std::get<0>(values)),
+            .locked = static_cast<bool>(std::get<2>(values)),
+            .marked_for_deletion = static_cast<bool>(std::get<3>(values)),
+        };
+    }
+
+    std::vector<std::string> do_list() {
+        auto& stmt = m_stmts.list;
+        auto reset = sqlite::use(stmt);
+        std::vector<std::string> out{};
+        while (true) {
+            auto res = sqlite::step_one(m_conn, stmt);
+            if (res == SQLITE_DONE) break;
+            if (res == SQLITE_BUSY) continue;
+            if (res == SQLITE_ROW) {
+                out.emplace_back(sqlite::unbind<std::string>(m_conn, stmt, 0));
+                continue;
+            }
+            throw ValueError("failed listing entries");
+        }
+        return out;
+    }
+
+    void prune_marked() {
+        std::vector<crypto::Sha256> deleted{};
+        {
+            auto& stmt = m_stmts.prune_marked;
+            auto reset = sqlite::use(stmt);
+            while (sqlite::step_one(m_conn, stmt) == SQLITE_ROW) {
+                deleted.push_back(
+                    sqlite::unbind<crypto::Sha256>(m_conn, stmt, 0));
+            }
+        }
+        for (const auto& digest : deleted) release(digest);
+    }
+
+    stdfs::path m_blobs;
+    stdfs::path m_tmp;
+    bool m_sync;
+    sqlite::Connection m_conn;
+    // the index is only accessed with the mutex held
+    Statements m_stmts;
+    std::mutex m_mutex{};
+};
+
+/**
+ * \brief Writes a payload to a temporary file
+ *
+ * The file is moved into place and the key added to the index in commit().
+ * Dropping the writer before that deletes the file.
+ * */
+class FsWriter final : public StoreWriter {
+ public:
+    FsWriter(FsStore& store, CStr key, size_t size,
+             std::optional<crypto::Sha256> expected_digest)
+        : m_store(&store),
+          m_key(key),
+          m_size(size),
+          m_expected(expected_digest),
+          m_hasher(store_detail::make_hasher(size)) {
+        std::tie(m_path, m_fd) = m_store->temp_file();
+    }
+
+    ~FsWriter() override {
+        if (m_done) return;
+        m_fd = Fd();
+        std::error_code ec{};
+        stdfs::remove(m_path, ec);
+        if (ec) {
+            PLAI_WARN("failed to delete unfinished upload {}: {}",
+                      m_path.native(), ec.message());
+        }
+    }
+
+    void write(std::span<const uint8_t> data) override {
+        assert(!m_done);
+        if (data.size() > m_size - m_offset)
+            throw ValueError(plai::format(
+                "blob write exceeds the expected size of {} bytes", m_size));
+        match(m_hasher, [&](auto& h) { h.update(data); });
+        write_all(m_fd, data, m_path);
+        m_offset += data.size();
+    }
+
+    BlobMeta commit() override {
+        assert(!m_done);
+        if (m_offset != m_size)
+            throw ValueError(
+                plai::format("blob incomplete: expected {} bytes, got {}",
+                             m_size, m_offset));
+        auto digest = match(m_hasher, [](auto& h) { return h.finish(); });
+        if (m_expected && *m_expected != digest)
+            throw DigestMismatch(plai::format(
+                "digest mismatch: expected {}, got {}",
+                crypto::hex_str(*m_expected), crypto::hex_str(digest)));
+        std::lock_guard lock(m_store->m_mutex);
+        m_store->publish(m_path, m_fd, digest);
+        m_done = true;
+        m_store->set_meta(m_key, digest, m_size);
+        return {
+            .bytes = m_size,
+            .sha256 = digest,
+            .locked = false,
+            .marked_for_deletion = false,
+        };
+    }
+
+ private:
+    FsStore* m_store;
+    std::string m_key;
+    stdfs::path m_path{};
+    Fd m_fd{};
+    size_t m_size;
+    size_t m_offset{};
+    std::optional<crypto::Sha256> m_expected;
+    store_detail::Hasher m_hasher;
+    bool m_done{};
+};
+
+std::unique_ptr<StoreWriter> FsStore::writer(
+    CStr key, size_t expected_size,
+    std::optional<crypto::Sha256> expected_digest) {
+    return std::make_unique<FsWriter>(*this, key, expected_size,
+                                      expected_digest);
+}
+
+std::unique_ptr<Store> fs_store(CStr path, const SqliteOpts& opts) {
+    return std::make_unique<FsStore>(stdfs::path(path.view()), opts);
+}
+
+}  // namespace plai
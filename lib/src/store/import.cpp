@@ -0,0 +1,216 @@
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <boost/asio/use_future.hpp>
+#include <fstream>
+#include <future>
+#include <plai/crypto.hpp>
+#include <plai/exceptions.hpp>
+#include <plai/format.hpp>
+#include <plai/fs/read.hpp>
+#include <plai/logs/logs.hpp>
+#include <plai/net/api.hpp>
+#include <plai/store_import.hpp>
+
+namespace plai {
+namespace {
+namespace stdfs = std::filesystem;
+
+struct Entry {
+    stdfs::path path;
+    std::string key;
+    size_t size;
+};
+
+std::vector<Entry> list_files(const stdfs::path& dir, ImportStats& stats) {
+    std::vector<Entry> out{};
+    for (const auto& e : stdfs::recursive_directory_iterator(dir)) {
+        if (!e.is_regular_file()) continue;
+        auto rel = e.path().lexically_relative(dir);
+        auto key = import_key(rel);
+        if (!key) {
+            PLAI_WARN("skipping {}, not an image/ or video/ file",
+                      rel.generic_string());
+            ++stats.ignored;
+            continue;
+        }
+        out.push_back({
+            .path = e.path(),
+            .key = std::move(*key),
+            .size = e.file_size(),
+        });
+    }
+    std::ranges::sort(out, {}, &Entry::key);
+    return out;
+}
+
+constexpr size_t STREAM_CHUNK_SIZE = 1024 * 1024;
+
+/**
+ * \brief Call `fn` with consecutive chunks of a file
+ * */
+template <class Fn>
+void for_each_chunk(const stdfs::path& path, Fn&& fn) {
+    auto in = std::ifstream(path, std::ios::binary);
+    if (!in) throw ValueError(format("could not open {}", path.native()));
+    std::vector<uint8_t> buf(STREAM_CHUNK_SIZE);
+    // NOLINTNEXTLINE
+    while (in.read(reinterpret_cast<char*>(buf.data()), buf.size()) ||
+           in.gcount() > 0) {
+        fn(std::span(buf).subspan(0, static_cast<size_t>(in.gcount())));
+    }
+    if (in.bad()) throw ValueError(format("error reading {}", path.native()));
+}
+
+/**
+ * \brief File hashed on the pool
+ *
+ * Files that are streamed are not kept in memory.
+ * */
+struct Loaded {
+    std::vector<uint8_t> data;
+    crypto::Sha256 digest;
+};
+
+/**
+ * \brief Files whose hashing has been started
+ * */
+struct Batch {
+    std::span<const Entry> entries;
+    bool streamed;
+    std::vector<std::future<Loaded>> loaded{};
+};
+
+class Importer {
+ public:
+    Importer(Store* store, const ImportOpts& opts, ImportStats stats)
+        : m_store(store),
+          m_pool(std::max<size_t>(opts.jobs, 1)),
+          m_batch_bytes(opts.batch_bytes),
+          m_stats(stats) {}
+
+    ImportStats run(std::span<const Entry> entries) {
+        // the next batch is hashed while the current one is stored
+        auto next = start(entries);
+        while (next) {
+            auto cur = std::move(*next);
+            entries = entries.subspan(cur.entries.size());
+            next = start(entries);
+            store(cur);
+        }
+        return m_stats;
+    }
+
+ private:
+    /**
+     * \brief Start hashing the files that make up the first batch of `entries`
+     *
+     * A batch is either files up to the batch size together or a single
+     * file larger than that.
+     * */
+    std::optional<Batch> start(std::span<const Entry> entries) {
+        if (entries.empty()) return std::nullopt;
+        if (entries.front().size >= m_batch_bytes) {
+            auto out =
+                Batch{.entries = entries.subspan(0, 1), .streamed = true};
+            out.loaded.push_back(post([path = entries.front().path] {
+                auto hasher = crypto::Sha256Hasher();
+                for_each_chunk(path,
+                               [&](auto chunk) { hasher.update(chunk); });
+                return Loaded{.data = {}, .digest = hasher.finish()};
+            }));
+            return out;
+        }
+        size_t count = 0;
+        size_t bytes = 0;
+        while (count < entries.size() &&
+               entries[count].size < m_batch_bytes &&
+               bytes + entries[count].size <= m_batch_bytes) {
+            bytes += entries[count++].size;
+        }
+        auto out =
+            Batch{.entries = entries.subspan(0, count), .streamed = false};
+        for (const auto& entry : out.entries) {
+            out.loaded.push_back(post([path = entry.path] {
+                auto data = fs::read_bin(path);
+                auto digest = crypto::sha256(data);
+                return Loaded{.data = std::move(data), .digest = digest};
+            }));
+        }
+        return out;
+    }
+
+    template <class Fn>
+    std::future<Loaded> post(Fn fn) {
+        return boost::asio::post(m_pool,
+                                 boost::asio::use_future(std::move(fn)));
+    }
+
+    void store(Batch& batch) {
+        std::vector<Loaded> loaded{};
+        loaded.reserve(batch.loaded.size());
+        std::vector<StoreItem> items{};
+        for (size_t i = 0; i < batch.entries.size(); ++i) {
+            const auto& entry = batch.entries[i];
+            const auto& file = loaded.emplace_back(batch.loaded[i].get());
+            auto meta = m_store->inspect(entry.key);
+            if (meta && meta->sha256 == file.digest) {
+                PLAI_DEBUG("{} is up to date", entry.key);
+                ++m_stats.skipped;
+                continue;
+            }
+            // the content is already stored under another key
+            if (m_store->link(entry.key, file.digest)) {
+                PLAI_DEBUG("{} linked", entry.key);
+                ++m_stats.linked;
+                continue;
+            }
+            ++m_stats.imported;
+            m_stats.bytes += entry.size;
+            if (batch.streamed) {
+                stream(entry, file.digest);
+                continue;
+            }
+            items.push_back(
+                {.key = entry.key, .blob = file.data, .digest = file.digest});
+        }
+        if (items.empty()) return;
+        PLAI_DEBUG("storing {} files", items.size());
+        m_store->store_many(items);
+    }
+
+    void stream(const Entry& entry, const crypto::Sha256& digest) {
+        PLAI_DEBUG("streaming {}", entry.key);
+        auto writer = m_store->writer(entry.key, entry.size, digest);
+        for_each_chunk(entry.path, [&](auto chunk) { writer->write(chunk); });
+        writer->commit();
+    }
+
+    Store* m_store;
+    boost::asio::thread_pool m_pool;
+    size_t m_batch_bytes;
+    ImportStats m_stats;
+};
+
+}  // namespace
+
+std::optional<std::string> import_key(const stdfs::path& rel) {
+    auto it = rel.begin();
+    if (it == rel.end() || !net::parse_media_type(it->native())) {
+        return std::nullopt;
+    }
+    if (++it == rel.end()) return std::nullopt;
+    auto name = it->native();
+    // hidden files such as .DS_Store are not media
+    if (name.empty() || name.starts_with('.')) return std::nullopt;
+    if (++it != rel.end()) return std::nullopt;
+    return rel.generic_string();
+}
+
+ImportStats import_dir(Store& store, const stdfs::path& dir,
+                       const ImportOpts& opts) {
+    ImportStats stats{};
+    auto entries = list_files(dir, stats);
+    return Importer(&store, opts, stats).run(entries);
+}
+
+}  // namespace plai
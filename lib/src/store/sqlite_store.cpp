@@ -0,0 +1,735 @@
+#include <sqlite3.h>
+
+#include <array>
+#include <cassert>
+#include <algorithm>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <plai/crypto.hpp>
+#include <plai/format.hpp>
+#include <plai/logs/logs.hpp>
+#include <plai/store.hpp>
+#include <plai/time.hpp>
+#include <plai/util/defer.hpp>
+#include <plai/util/match.hpp>
+#include <type_traits>
+#include <variant>
+
+#include "sqlite.hpp"
+#include "store/common.hpp"
+
+namespace plai {
+namespace {
+namespace stdfs = std::filesystem;
+
+// Version 0 is the original layout with the payload stored inline with
+// the metadata. New databases are created with it so that all of them go
+// through the same migrations.
+constexpr std::array<CStr, 2> migrations = {
+    "CREATE TABLE IF NOT EXISTS plai (name STRING PRIMARY KEY, sha256 BLOB, "
+    "bytes INTEGER, locked BOOLEAN, marked_for_deletion BOOLEAN, data BLOB);"
+    // metadata and payload in separate tables, so that listing, inspecting
+    // and locking don't walk the overflow pages of the payloads
+    "CREATE TABLE media (name TEXT PRIMARY KEY, sha256 BLOB, bytes INTEGER, "
+    "locked BOOLEAN, marked_for_deletion BOOLEAN, payload INTEGER) "
+    "WITHOUT ROWID;"
+    "CREATE TABLE payload (id INTEGER PRIMARY KEY, data BLOB);"
+    // copied rather than renamed, media needs ids that VACUUM keeps and an
+    // INTEGER PRIMARY KEY can not be added to an existing table
+    "INSERT INTO payload (id, data) SELECT rowid, data FROM plai;"
+    "INSERT INTO media SELECT name, sha256, bytes, locked, "
+    "marked_for_deletion, rowid FROM plai;"
+    "DROP TABLE plai;"
+    "CREATE TRIGGER media_delete AFTER DELETE ON media BEGIN "
+    "DELETE FROM payload WHERE id=OLD.payload; END;"
+    "CREATE TRIGGER media_replace AFTER UPDATE OF payload ON media "
+    "WHEN OLD.payload IS NOT NEW.payload BEGIN "
+    "DELETE FROM payload WHERE id=OLD.payload; END;",
+
+    // payloads shared by all keys with the same digest, payloads of
+    // duplicate keys are merged into one
+    "ALTER TABLE payload ADD COLUMN sha256 BLOB;"
+    "ALTER TABLE payload ADD COLUMN refs INTEGER NOT NULL DEFAULT 0;"
+    "UPDATE payload SET sha256=(SELECT sha256 FROM media WHERE "
+    "media.payload=payload.id);"
+    // media_replace deletes the duplicates
+    "UPDATE media SET payload=(SELECT min(id) FROM payload WHERE "
+    "payload.sha256=media.sha256);"
+    "DROP TRIGGER media_delete;"
+    "DROP TRIGGER media_replace;"
+    "UPDATE payload SET refs=(SELECT count(*) FROM media WHERE "
+    "media.payload=payload.id);"
+    "DELETE FROM payload WHERE refs=0;"
+    "CREATE UNIQUE INDEX payload_sha256 ON payload (sha256);"
+    "CREATE TRIGGER media_insert AFTER INSERT ON media BEGIN "
+    "UPDATE payload SET refs=refs+1 WHERE id=NEW.payload; END;"
+    "CREATE TRIGGER media_delete AFTER DELETE ON media BEGIN "
+    "UPDATE payload SET refs=refs-1 WHERE id=OLD.payload;"
+    "DELETE FROM payload WHERE id=OLD.payload AND refs<=0; END;"
+    "CREATE TRIGGER media_replace AFTER UPDATE OF payload ON media "
+    "WHEN OLD.payload IS NOT NEW.payload BEGIN "
+    "UPDATE payload SET refs=refs+1 WHERE id=NEW.payload;"
+    "UPDATE payload SET refs=refs-1 WHERE id=OLD.payload;"
+    "DELETE FROM payload WHERE id=OLD.payload AND refs<=0; END;",
+};
+
+constexpr CStr list_stmt = "SELECT name FROM media;";
+constexpr CStr insert_payload_stmt =
+    "INSERT INTO payload (data, sha256) VALUES (?,?);";
+constexpr CStr insert_zeroblob_stmt =
+    "INSERT INTO payload (data, sha256) VALUES (zeroblob(?), ?);";
+constexpr CStr find_payload_stmt = "SELECT id FROM payload WHERE sha256=?;";
+// Reference counts of payloads are maintained by triggers on media. Payloads
+// no longer referenced are deleted.
+constexpr CStr upsert_media_stmt =
+    "INSERT INTO media VALUES (?,?,?,0,0,?) ON CONFLICT (name) DO UPDATE SET "
+    "sha256=excluded.sha256, bytes=excluded.bytes, locked=0, "
+    "marked_for_deletion=0, payload=excluded.payload;";
+constexpr CStr link_stmt =
+    "INSERT INTO media SELECT ?, sha256, length(data), 0, 0, id FROM payload "
+    "WHERE sha256=? ON CONFLICT (name) DO UPDATE SET sha256=excluded.sha256, "
+    "bytes=excluded.bytes, locked=0, marked_for_deletion=0, "
+    "payload=excluded.payload;";
+constexpr CStr inspect_stmt =
+    "SELECT sha256, bytes, locked, marked_for_deletion FROM media WHERE "
+    "(name=?);";
+constexpr CStr read_stmt =
+    "SELECT data FROM payload WHERE id=(SELECT payload FROM media WHERE "
+    "name=?);";
+constexpr CStr payload_of_stmt =
+    "SELECT payload, sha256 FROM media WHERE name=?;";
+constexpr CStr set_locked_stmt = "UPDATE media SET locked=? WHERE name=?;";
+constexpr CStr mark_for_deletion_stmt =
+    "UPDATE media SET marked_for_deletion=? WHERE name=?;";
+constexpr CStr prune_marked_stmt =
+    "DELETE FROM media WHERE (marked_for_deletion=1 AND locked=0);";
+
+/**
+ * \brief Statements for the fixed queries that modify the database
+ * */
+struct Statements {
+    explicit Statements(sqlite::Connection& conn)
+        : insert_payload(sqlite::statement(conn.get(), insert_payload_stmt)),
+          insert_zeroblob(
+              sqlite::statement(conn.get(), insert_zeroblob_stmt)),
+          find_payload(sqlite::statement(conn.get(), find_payload_stmt)),
+          upsert_media(sqlite::statement(conn.get(), upsert_media_stmt)),
+          link(sqlite::statement(conn.get(), link_stmt)),
+          set_locked(sqlite::statement(conn.get(), set_locked_stmt)),
+          mark_for_deletion(
+              sqlite::statement(conn.get(), mark_for_deletion_stmt)),
+          prune_marked(sqlite::statement(conn.get(), prune_marked_stmt)) {}
+
+    sqlite::Statement insert_payload;
+    sqlite::Statement insert_zeroblob;
+    sqlite::Statement find_payload;
+    sqlite::Statement upsert_media;
+    sqlite::Statement link;
+    sqlite::Statement set_locked;
+    sqlite::Statement mark_for_deletion;
+    sqlite::Statement prune_marked;
+};
+
+/**
+ * \brief Statements for the read-only queries
+ * */
+struct ReadStatements {
+    explicit ReadStatements(sqlite::Connection& conn)
+        : list(sqlite::statement(conn.get(), list_stmt)),
+          inspect(sqlite::statement(conn.get(), inspect_stmt)),
+          read(sqlite::statement(conn.get(), read_stmt)),
+          payload_of(sqlite::statement(conn.get(), payload_of_stmt)),
+          find_payload(sqlite::statement(conn.get(), find_payload_stmt)) {}
+
+    sqlite::Statement list;
+    sqlite::Statement inspect;
+    sqlite::Statement read;
+    sqlite::Statement payload_of;
+    sqlite::Statement find_payload;
+};
+
+/**
+ * \brief Read-only connection with its prepared statements
+ * */
+struct Reader {
+    explicit Reader(sqlite::Connection c)
+        : conn(std::move(c)), stmts(conn) {}
+
+    sqlite::Connection conn;
+    ReadStatements stmts;
+};
+
+/**
+ * \brief Read-only connections, each used by one thread at a time
+ *
+ * Connections are opened on demand up to a maximum. When all of them are in
+ * use, acquire() waits for one to be released.
+ * */
+class ReaderPool {
+    struct Release {
+        ReaderPool* pool;
+        void operator()(Reader* reader) const noexcept {
+            pool->release(reader);
+        }
+    };
+
+ public:
+    using Lease = std::unique_ptr<Reader, Release>;
+
+    ReaderPool(CStr path, const SqliteOpts& opts)
+        : m_path(path.view()), m_opts(opts) {
+        assert(m_opts.max_readers > 0);
+    }
+
+    ReaderPool(const ReaderPool&) = delete;
+    ReaderPool& operator=(const ReaderPool&) = delete;
+
+    /**
+     * \brief Open a connection that is not part of the pool
+     *
+     * For reads that take long, which would otherwise keep a connection from
+     * the pool.
+     * */
+    std::unique_ptr<Reader> open_unpooled() const {
+        return std::make_unique<Reader>(
+            store_detail::open_reader(m_path, m_opts));
+    }
+
+    Lease acquire() {
+        std::unique_lock lock(m_mutex);
+        m_cv.wait(lock, [&] {
+            return !m_idle.empty() || m_open < m_opts.max_readers;
+        });
+        if (!m_idle.empty()) {
+            auto* reader = m_idle.back().release();
+            m_idle.pop_back();
+            return Lease(reader, Release{this});
+        }
+        ++m_open;
+        lock.unlock();
+        try {
+            auto reader = std::make_unique<Reader>(
+                store_detail::open_reader(m_path, m_opts));
+            return Lease(reader.release(), Release{this});
+        } catch (...) {
+            lock.lock();
+            --m_open;
+            m_cv.notify_one();
+            throw;
+        }
+    }
+
+ private:
+    void release(Reader* reader) noexcept {
+        {
+            std::lock_guard lock(m_mutex);
+            m_idle.emplace_back(reader);
+        }
+        m_cv.notify_one();
+    }
+
+    std::string m_path;
+    SqliteOpts m_opts;
+    std::mutex m_mutex{};
+    std::condition_variable m_cv{};
+    std::vector<std::unique_ptr<Reader>> m_idle{};
+    size_t m_open{};
+};
+
+bool is_in_memory(CStr path) {
+    return path.view().empty() || path.view() == ":memory:";
+}
+
+/**
+ * \brief Id of the payload with the given digest
+ * */
+std::optional<int64_t> find_payload(sqlite::Connection& conn,
+                                    sqlite::Statement& stmt,
+                                    const crypto::Sha256& digest) {
+    auto reset = sqlite::use(stmt);
+    sqlite::bind_all(conn, stmt, digest);
+    if (sqlite::step_one(conn, stmt) != SQLITE_ROW) return std::nullopt;
+    return sqlite::unbind<int64_t>(conn, stmt, 0);
+}
+
+std::optional<BlobMeta> do_inspect(sqlite::Connection& conn,
+                                   ReadStatements& stmts, CStr key) {
+    auto& stmt = stmts.inspect;
+    auto reset = sqlite::use(stmt);
+    sqlite::bind_all(conn, stmt, key);
+    int res = SQLITE_BUSY;
+    while (res == SQLITE_BUSY) { res = sqlite::step_one(conn, stmt); }
+    if (res == SQLITE_DONE) return std::nullopt;
+    assert(res == SQLITE_ROW);
+    auto values =
+        sqlite::unbind_all<crypto::Sha256, int64_t, int64_t, int64_t>(conn,
+                                                                      stmt);
+    return BlobMeta{
+        .bytes = static_cast<size_t>(std::move(std::get<1>(values))),
+        .sha256 = std::move(std::get<0>(values)),
+        .locked = static_cast<bool>(std::get<2>(values)),
+        .marked_for_deletion = static_cast<bool>(std::get<3>(values)),
+    };
+}
+
+std::vector<std::string> do_list(sqlite::Connection& conn,
+                                 ReadStatements& stmts) {
+    auto& stmt = stmts.list;
+    auto reset = sqlite::use(stmt);
+    std::vector<std::string> out{};
+    while (true) {
+        auto res = sqlite::step_one(conn, stmt);
+        if (res == SQLITE_DONE) break;
+        if (res == SQLITE_BUSY) continue;
+        if (res == SQLITE_ROW) {
+            out.emplace_back(sqlite::unbind<std::string>(conn, stmt, 0));
+            continue;
+        }
+        throw ValueError("failed listing entries");
+    }
+    return out;
+}
+
+std::vector<uint8_t> do_read(sqlite::Connection& conn, ReadStatements& stmts,
+                             CStr key) {
+    auto& stmt = stmts.read;
+    auto reset = sqlite::use(stmt);
+    sqlite::bind_all(conn, stmt, key);
+    int res = SQLITE_BUSY;
+    while (res == SQLITE_BUSY) { res = sqlite::step_one(conn, stmt); }
+    if (res != SQLITE_ROW)
+        throw ValueError(plai::format("no data in storage matching key '{}'",
+                                      key.view()));
+    auto data = sqlite::unbind_all<std::vector<uint8_t>>(conn, stmt);
+    return std::get<0>(std::move(data));
+}
+
+/**
+ * \brief Id and digest of the payload of `key`
+ * */
+std::pair<int64_t, crypto::Sha256> payload_of(sqlite::Connection& conn,
+                                              ReadStatements& stmts,
+                                              CStr key) {
+    auto& stmt = stmts.payload_of;
+    auto reset = sqlite::use(stmt);
+    sqlite::bind_all(conn, stmt, key);
+    int res = SQLITE_BUSY;
+    while (res == SQLITE_BUSY) { res = sqlite::step_one(conn, stmt); }
+    if (res != SQLITE_ROW)
+        throw ValueError(plai::format("no data in storage matching key '{}'",
+                                      key.view()));
+    auto [id, digest] =
+        sqlite::unbind_all<int64_t, crypto::Sha256>(conn, stmt);
+    return {id, digest};
+}
+
+/**
+ * \brief Read part of the payload of `key` in a short transaction
+ * */
+std::vector<uint8_t> do_read_range(sqlite::Connection& conn,
+                                   ReadStatements& stmts, CStr key,
+                                   size_t offset, size_t len) {
+    // the lookup and opening the blob see the same snapshot
+    sqlite::exec(conn, "BEGIN;");
+    // nothing is written, so rolling back ends it just as well
+    auto end = Defer([&] { sqlite::rollback(conn); });
+    auto blob = sqlite::open_blob(conn, "payload", "data",
+                                  payload_of(conn, stmts, key).first, false);
+    const auto size = static_cast<size_t>(sqlite3_blob_bytes(blob.get()));
+    if (offset >= size) return {};
+    std::vector<uint8_t> out(std::min(len, size - offset));
+    sqlite::read_blob(conn, blob, out, offset);
+    return out;
+}
+
+/**
+ * \brief Reader over a copy of the blob
+ *
+ * For stores without read-only connections, where a reader could only
+ * keep its snapshot by holding the writer connection.
+ * */
+class CopyReader final : public StoreReader {
+ public:
+    explicit CopyReader(std::vector<uint8_t> data) : m_data(std::move(data)) {}
+
+    size_t size() const noexcept override { return m_data.size(); }
+
+    size_t read(size_t offset, std::span<uint8_t> out) override {
+        if (offset >= m_data.size()) return 0;
+        out = out.subspan(0, std::min(out.size(), m_data.size() - offset));
+        std::copy_n(m_data.begin() + static_cast<ptrdiff_t>(offset),
+                    out.size(), out.begin());
+        return out.size();
+    }
+
+ private:
+    std::vector<uint8_t> m_data;
+};
+
+}  // namespace
+
+/**
+ * \brief Reads a payload via SQLite's incremental blob I/O
+ *
+ * The blob handle stays open, so SQLite keeps the position of its overflow
+ * pages and reads at any offset do not walk the payload from the start. It
+ * also keeps a read transaction open on the reader's own connection, which
+ * holds on to the snapshot the reader started with.
+ *
+ * An open read transaction keeps checkpoints from getting past it, so the
+ * WAL would grow for as long as a media plays. Once the snapshot is older
+ * than SqliteOpts::max_snapshot_age, the reader moves to a new one if that
+ * still has the payload. Payloads are found by digest, so the content read
+ * stays the same. Otherwise it keeps the old snapshot.
+ * */
+class SqliteReader final : public StoreReader {
+ public:
+    SqliteReader(const ReaderPool& pool, Duration max_age, CStr key)
+        : m_pool(&pool), m_max_age(max_age) {
+        auto reader = m_pool->open_unpooled();
+        // the lookup and opening the blob see the same snapshot
+        sqlite::exec(reader->conn, "BEGIN;");
+        int64_t payload{};
+        std::tie(payload, m_digest) =
+            payload_of(reader->conn, reader->stmts, key);
+        open(std::move(reader), payload);
+        m_size = static_cast<size_t>(sqlite3_blob_bytes(m_blob.get()));
+    }
+
+    size_t size() const noexcept override { return m_size; }
+
+    size_t read(size_t offset, std::span<uint8_t> out) override {
+        if (offset >= m_size) return 0;
+        out = out.subspan(0, std::min(out.size(), m_size - offset));
+        if (Clock::now() - m_opened >= m_max_age) renew();
+        sqlite::read_blob(m_reader->conn, m_blob, out, offset);
+        return out.size();
+    }
+
+ private:
+    /**
+     * \brief Read `payload` via `reader` from now on
+     * */
+    void open(std::unique_ptr<Reader> reader, int64_t payload) {
+        auto blob =
+            sqlite::open_blob(reader->conn, "payload", "data", payload, false);
+        // closed before the connection it belongs to
+        m_blob = std::move(blob);
+        m_reader = std::move(reader);
+        m_opened = Clock::now();
+    }
+
+    void renew() {
+        auto reader = m_pool->open_unpooled();
+        sqlite::exec(reader->conn, "BEGIN;");
+        auto payload =
+            find_payload(reader->conn, reader->stmts.find_payload, m_digest);
+        if (!payload) {
+            PLAI_DEBUG("payload removed, keeping the snapshot of the reader");
+            m_opened = Clock::now();
+            return;
+        }
+        open(std::move(reader), *payload);
+    }
+
+    const ReaderPool* m_pool;
+    Duration m_max_age;
+    crypto::Sha256 m_digest{};
+    TimePoint m_opened{};
+    // declared before the blob, which has to be closed first
+    std::unique_ptr<Reader> m_reader{};
+    sqlite::Blob m_blob{nullptr, &sqlite3_blob_close};
+    size_t m_size{};
+};
+
+/**
+ * \brief Stages a blob in a temporary file until it is committed
+ *
+ * An open handle for incremental blob I/O keeps its transaction open, and
+ * reopening it per chunk walks the whole overflow chain of the payload each
+ * time. So the data is copied with a single handle in commit(), which keeps
+ * the writer connection free for other writes during a slow upload. The
+ * file is unlinked right away, so it is gone with the writer even after a
+ * crash.
+ *
+ * commit() holds the store's writer mutex as the connection and its
+ * statements are shared.
+ * */
+class SqliteWriter final : public StoreWriter {
+ public:
+    SqliteWriter(sqlite::Connection& conn, Statements& stmts,
+                 std::mutex& mutex, const stdfs::path& tmp_dir, CStr key,
+                 size_t size, std::optional<crypto::Sha256> expected_digest)
+        : m_conn(&conn),
+          m_stmts(&stmts),
+          m_mutex(&mutex),
+          m_key(key),
+          m_size(size),
+          m_expected(expected_digest),
+          m_hasher(store_detail::make_hasher(size)) {
+        std::tie(m_path, m_fd) = store_detail::temp_file(tmp_dir);
+        stdfs::remove(m_path);
+    }
+
+    void write(std::span<const uint8_t> data) override {
+        assert(!m_done);
+        if (data.size() > m_size - m_offset)
+            throw ValueError(plai::format(
+                "blob write exceeds the expected size of {} bytes", m_size));
+        match(m_hasher, [&](auto& h) { h.update(data); });
+        store_detail::write_all(m_fd, data, m_path);
+        m_offset += data.size();
+    }
+
+    BlobMeta commit() override {
+        assert(!m_done);
+        if (m_offset != m_size)
+            throw ValueError(
+                plai::format("blob incomplete: expected {} bytes, got {}",
+                             m_size, m_offset));
+        auto digest = match(m_hasher, [](auto& h) { return h.finish(); });
+        if (m_expected && *m_expected != digest)
+            throw DigestMismatch(plai::format(
+                "digest mismatch: expected {}, got {}",
+                crypto::hex_str(*m_expected), crypto::hex_str(digest)));
+        std::lock_guard lock(*m_mutex);
+        sqlite::exec(*m_conn, "BEGIN IMMEDIATE;");
+        auto rollback = Defer([&] { sqlite::rollback(*m_conn); });
+        // an existing payload with the same digest is shared
+        auto payload = find_payload(*m_conn, m_stmts->find_payload, digest);
+        if (!payload) payload = copy_payload(digest);
+        {
+            auto& stmt = m_stmts->upsert_media;
+            auto reset = sqlite::use(stmt);
+            sqlite::bind_all(*m_conn, stmt, m_key, digest, m_size, *payload);
+            sqlite::step_all(*m_conn, stmt);
+        }
+        sqlite::exec(*m_conn, "COMMIT;");
+        rollback.cancel();
+        m_done = true;
+        return {
+            .bytes = m_size,
+            .sha256 = digest,
+            .locked = false,
+            .marked_for_deletion = false,
+        };
+    }
+
+ private:
+    static constexpr size_t COPY_CHUNK_SIZE = 1024 * 1024;
+
+    /**
+     * \brief Insert the staged data as a new payload
+     *
+     * \return Id of the payload
+     * */
+    int64_t copy_payload(const crypto::Sha256& digest) {
+        int64_t id{};
+        {
+            auto& stmt = m_stmts->insert_zeroblob;
+            auto reset = sqlite::use(stmt);
+            sqlite::bind_all(*m_conn, stmt, m_size, digest);
+            sqlite::step_all(*m_conn, stmt);
+            id = sqlite3_last_insert_rowid(m_conn->get());
+        }
+        auto blob = sqlite::open_blob(*m_conn, "payload", "data", id, true);
+        std::vector<uint8_t> buf(std::min(m_size, COPY_CHUNK_SIZE));
+        for (size_t off = 0; off < m_size; off += buf.size()) {
+            auto chunk = std::span(buf).subspan(
+                0, std::min(buf.size(), m_size - off));
+            store_detail::read_all(m_fd, chunk, static_cast<int64_t>(off),
+                                   m_path);
+            sqlite::write_blob(*m_conn, blob, chunk, off);
+        }
+        return id;
+    }
+
+    sqlite::Connection* m_conn;
+    Statements* m_stmts;
+    std::mutex* m_mutex;
+    std::string m_key;
+    stdfs::path m_path{};
+    store_detail::Fd m_fd{};
+    size_t m_size;
+    size_t m_offset{};
+    std::optional<crypto::Sha256> m_expected;
+    store_detail::Hasher m_hasher;
+    bool m_done{};
+};
+
+/**
+ * \brief Store keeping metadata and payloads in one SQLite database
+ *
+ * All writes go through a single connection guarded by a mutex. Reads use a
+ * pool of read-only connections, so that in WAL mode they neither wait for
+ * writes nor for each other.
+ * */
+class SqliteStore final : public Store {
+ public:
+    using Store::writer;
+
+    SqliteStore(CStr path, const SqliteOpts& opts)
+        : m_conn(store_detail::open_db(path, opts, migrations)),
+          m_stmts(m_conn),
+          m_read_stmts(m_conn),
+          m_tmp_dir(stdfs::temp_directory_path()) {
+        if (is_in_memory(path)) return;
+        // next to the database rather than in a possibly small tmpfs
+        m_tmp_dir = stdfs::absolute(path.view()).parent_path();
+        if (opts.max_readers > 0) m_readers.emplace(path, opts);
+        m_max_snapshot_age = opts.max_snapshot_age;
+    }
+
+    std::vector<std::string> list() final {
+        return with_reader(
+            [](auto& conn, auto& stmts) { return do_list(conn, stmts); });
+    }
+
+    void store(CStr key, std::span<const uint8_t> blob) final {
+        const auto item = StoreItem{.key = key, .blob = blob};
+        store_many(std::span(&item, 1));
+    }
+
+    void store_many(std::span<const StoreItem> items) final {
+        const auto digests = store_detail::digests_of(items);
+        std::lock_guard lock(m_mutex);
+        sqlite::exec(m_conn, "BEGIN IMMEDIATE;");
+        auto rollback = Defer([&] { sqlite::rollback(m_conn); });
+        for (size_t i = 0; i < items.size(); ++i) {
+            const auto& [key, blob, _] = items[i];
+            const auto& digest = digests[i];
+            auto payload = find_payload(m_conn, m_stmts.find_payload, digest);
+            if (!payload) {
+                auto& stmt = m_stmts.insert_payload;
+                auto reset = sqlite::use(stmt);
+                sqlite::bind_all(m_conn, stmt, blob, digest);
+                sqlite::step_all(m_conn, stmt);
+                payload = sqlite3_last_insert_rowid(m_conn.get());
+            }
+            auto& stmt = m_stmts.upsert_media;
+            auto reset = sqlite::use(stmt);
+            sqlite::bind_all(m_conn, stmt, key, digest, blob.size(), *payload);
+            sqlite::step_all(m_conn, stmt);
+        }
+        sqlite::exec(m_conn, "COMMIT;");
+        rollback.cancel();
+    }
+
+    std::unique_ptr<StoreWriter> writer(
+        CStr key, size_t expected_size,
+        std::optional<crypto::Sha256> expected_digest) final {
+        return std::make_unique<SqliteWriter>(m_conn, m_stmts, m_mutex,
+                                              m_tmp_dir, key, expected_size,
+                                              expected_digest);
+    }
+
+    std::optional<BlobMeta> link(CStr key,
+                                 const crypto::Sha256& digest) final {
+        std::lock_guard lock(m_mutex);
+        {
+            auto& stmt = m_stmts.link;
+            auto reset = sqlite::use(stmt);
+            sqlite::bind_all(m_conn, stmt, key, digest);
+            sqlite::step_all(m_conn, stmt);
+        }
+        if (sqlite3_changes(m_conn.get()) == 0) return std::nullopt;
+        return do_inspect(m_conn, m_read_stmts, key);
+    }
+
+    std::optional<BlobMeta> inspect(CStr key) final {
+        return with_reader([&](auto& conn, auto& stmts) {
+            return do_inspect(conn, stmts, key);
+        });
+    }
+
+    LockResult lock(std::span<CStr> keys) final {
+        std::lock_guard lock(m_mutex);
+        return store_detail::set_locked(m_conn, m_stmts.set_locked, keys,
+                                        true);
+    }
+
+    void unlock(std::span<CStr> keys) final {
+        std::lock_guard lock(m_mutex);
+        store_detail::set_locked(m_conn, m_stmts.set_locked, keys, false);
+        prune_marked();
+    }
+
+    std::vector<uint8_t> read(CStr key) final {
+        return with_reader([&](auto& conn, auto& stmts) {
+            return do_read(conn, stmts, key);
+        });
+    }
+
+    std::vector<uint8_t> read_range(CStr key, size_t offset,
+                                    size_t len) final {
+        return with_reader([&](auto& conn, auto& stmts) {
+            return do_read_range(conn, stmts, key, offset, len);
+        });
+    }
+
+    std::unique_ptr<StoreReader> reader(CStr key) final {
+        if (m_readers) {
+            return std::make_unique<SqliteReader>(*m_readers,
+                                                  m_max_snapshot_age, key);
+        }
+        // a copy is the only snapshot that does not hold the writer
+        // connection for the lifetime of the reader
+        return std::make_unique<CopyReader>(read(key));
+    }
+
+    void remove(CStr key) final {
+        std::lock_guard lock(m_mutex);
+        {
+            auto& stmt = m_stmts.mark_for_deletion;
+            auto reset = sqlite::use(stmt);
+            sqlite::bind_all(m_conn, stmt, 1, key);
+            sqlite::step_all(m_conn, stmt);
+        }
+        prune_marked();
+    }
+
+    CompactStats compact(size_t max_pages) final {
+        std::lock_guard lock(m_mutex);
+        return store_detail::incremental_vacuum(m_conn, max_pages);
+    }
+
+ private:
+    /**
+     * \brief Call `f` with a connection for reading and its statements
+     *
+     * Falls back to the writer connection without a pool.
+     * */
+    template <class F>
+    std::invoke_result_t<F&, sqlite::Connection&, ReadStatements&>
+    with_reader(F&& f) {
+        if (m_readers) {
+            auto reader = m_readers->acquire();
+            return f(reader->conn, reader->stmts);
+        }
+        std::lock_guard lock(m_mutex);
+        return f(m_conn, m_read_stmts);
+    }
+
+    void prune_marked() {
+        auto& stmt = m_stmts.prune_marked;
+        auto reset = sqlite::use(stmt);
+        sqlite::step_all(m_conn, stmt);
+    }
+
+    sqlite::Connection m_conn;
+    // statements of the writer connection are shared, so are only used with
+    // the mutex held
+    Statements m_stmts;
+    ReadStatements m_read_stmts;
+    std::mutex m_mutex{};
+    // where writers stage uploads
+    stdfs::path m_tmp_dir;
+    std::optional<ReaderPool> m_readers{};
+    Duration m_max_snapshot_age{};
+};
+
+std::unique_ptr<Store> sqlite_store(CStr path, const SqliteOpts& opts) {
+    return std::make_unique<SqliteStore>(path, opts);
+}
+}  // namespace plai
@@ -0,0 +1,92 @@
+#include <deque>
+#include <plai/flow/spec.hpp>
+#include <plai/format.hpp>
+#include <plai/time.hpp>
+
+namespace flow = plai::flow;
+namespace sched = plai::sched;
+
+namespace {
+
+constexpr size_t ITEMS = 2'000'000;
+
+/**
+ * \brief Source producing ITEMS numbers, notifying after each like a decoder
+ * */
+struct Counter final : public flow::Src<size_t> {
+    size_t produce() override {
+        auto out = next++;
+        if (src_ready()) notify_src_ready();
+        return out;
+    }
+    bool src_ready() override { return next < ITEMS; }
+
+    size_t next{0};
+};
+
+/**
+ * \brief Stage converting items, with room for a few of them
+ * */
+struct Proxy final : public flow::Sink<size_t>, public flow::Src<size_t> {
+    static constexpr size_t CAPACITY = 4;
+
+    void consume(size_t val) override {
+        buf.push_back(val * 2);
+        notify_src_ready();
+    }
+    bool sink_ready() override { return buf.size() < CAPACITY; }
+
+    size_t produce() override {
+        auto out = buf.front();
+        buf.pop_front();
+        notify_sink_ready();
+        return out;
+    }
+    bool src_ready() override { return !buf.empty(); }
+
+    std::deque<size_t> buf{};
+};
+
+struct Total final : public flow::Sink<size_t> {
+    explicit Total(sched::IoContext& ctx) : ctx(&ctx) {}
+
+    void consume(size_t val) override {
+        sum += val;
+        if (++count == ITEMS) ctx->stop();
+        notify_sink_ready();
+    }
+    bool sink_ready() override { return true; }
+
+    sched::IoContext* ctx;
+    size_t sum{0};
+    size_t count{0};
+};
+
+template <class F>
+void bench(std::string_view name, F&& make_pipeline) {
+    auto ctx = sched::IoContext();
+    auto src = Counter();
+    auto proxy = Proxy();
+    auto sink = Total(ctx);
+    auto start = plai::Clock::now();
+    auto pline = make_pipeline(ctx, src, proxy, sink);
+    ctx.run();
+    auto elapsed = plai::FloatDuration(plai::Clock::now() - start);
+    plai::println("{:>18}: {:.1f} M items/s ({} items)", name,
+                  static_cast<double>(sink.count) / elapsed.count() / 1e6,
+                  sink.count);
+}
+
+}  // namespace
+
+int main() {
+    bench("Connector", [](auto& ctx, auto& src, auto& proxy, auto& sink) {
+        return flow::pipeline(ctx) | src | proxy | sink |
+               flow::pipeline_finish();
+    });
+    bench("BufferedConnector",
+          [](auto& ctx, auto& src, auto& proxy, auto& sink) {
+              return flow::pipeline(ctx) | src | flow::buffered() | proxy |
+                     flow::buffered() | sink | flow::pipeline_finish();
+          });
+}
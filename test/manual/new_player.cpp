@@ -40,8 +40,16 @@ int main(int argc, char** argv) {
     plai::logs::init(plai::logs::Level::Debug);
     auto msrc = MediaSrc(read_medias(argc, argv));
     auto ctx = plai::sched::IoContext();
-    auto decoding_ctx = boost::asio::thread_pool(1);
-    auto decoder = plai::mods::make_decoder(decoding_ctx.get_executor());
+    // the next media is decoded while the current one plays
+    constexpr size_t DECODERS = 2;
+    auto decoding_ctx = boost::asio::thread_pool(DECODERS);
+    auto decoders = std::vector<std::unique_ptr<plai::mods::Decoder>>();
+    auto decoder_ptrs = std::vector<plai::mods::Decoder*>();
+    for (size_t i = 0; i < DECODERS; ++i) {
+        decoders.push_back(plai::mods::make_decoder(
+            boost::asio::make_strand(decoding_ctx.get_executor())));
+        decoder_ptrs.push_back(decoders.back().get());
+    }
 
     auto frontend = plai::frontend(plai::FrontendType::Sdl2);
     auto wm_conf = plai::play::Watermark{
@@ -57,7 +65,11 @@ int main(int argc, char** argv) {
     auto player = plai::mods::make_player(ctx.get_executor(), frontend.get(),
                                           std::move(opts));
 
-    auto pipeline = plai::flow::pipeline(ctx.get_executor()) | msrc | *decoder |
-                    *player | plai::flow::pipeline_finish();
+    auto pipeline =
+        plai::flow::pipeline(ctx.get_executor()) | msrc |
+        plai::flow::fan_out(
+            std::span<plai::mods::Decoder* const>(decoder_ptrs)) |
+        plai::flow::fan_in(plai::mods::ends_media) | *player |
+        plai::flow::pipeline_finish();
     ctx.run();
 }
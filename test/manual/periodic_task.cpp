@@ -12,6 +12,13 @@ int main() {
     plai::FloatDuration avg_period = plai::FloatDuration::zero();
 
     auto ctx = plai::sched::IoContext();
+    plai::sched::PeriodicTask* self = nullptr;
+    auto print_lateness = [&] {
+        auto late = self->lateness();
+        std::println("lateness p50: <= {}, p99: <= {}, max: {}, missed: {}",
+                     late.quantile(0.5), late.quantile(0.99), late.max,
+                     late.missed);
+    };
     auto task = plai::sched::task() | plai::sched::executor(ctx) |
                 plai::sched::period(period) |
                 [&] {
@@ -29,8 +36,10 @@ int main() {
                     max_period = std::max(max_period, delay);
                     std::println("last: {}, max: {}, avg: {}", delay,
                                  max_period, avg_period);
+                    if (measurements % 10 == 0) print_lateness();
                 } |
                 plai::sched::task_finish();
+    self = &task;
     prev = plai::Clock::now();
     ctx.run();
 }
@@ -28,8 +28,12 @@ class Api final : public plai::net::ApiV1 {
     }
 
     void put_media(MediaType type, std::string_view key,
+                   std::optional<size_t> size,
+                   std::optional<plai::crypto::Sha256> digest,
                    std::function<std::optional<std::span<const uint8_t>>()>
                        body) override {
+        (void)size;
+        (void)digest;
         std::vector<uint8_t> buf{};
         while (true) {
             auto r = body();
@@ -0,0 +1,117 @@
+#include <CLI/CLI.hpp>
+#include <atomic>
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+#include <plai/format.hpp>
+#include <plai/time.hpp>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace asio = boost::asio;
+using local = asio::local::stream_protocol;
+
+struct Options {
+    std::string socket{};
+    std::string target{"/plai/v1/_ping"};
+    size_t requests{10000};
+    size_t connections{1};
+    size_t depth{1};
+    bool close{false};
+};
+
+struct Counters {
+    std::atomic<size_t> ok{0};
+    std::atomic<size_t> failed{0};
+};
+
+std::string make_request(const Options& opts) {
+    http::request<http::empty_body> req{http::verb::get, opts.target, 11};
+    req.set(http::field::host, "localhost");
+    req.keep_alive(!opts.close);
+    std::ostringstream ss;
+    ss << req;
+    return ss.str();
+}
+
+/**
+ * \brief Send `count` requests, `depth` of them at a time on one connection
+ * */
+void run_connection(const Options& opts, size_t count, Counters& counters) {
+    auto raw = make_request(opts);
+    std::string batch{};
+    for (size_t i = 0; i < opts.depth; ++i) batch += raw;
+
+    asio::io_context ioc;
+    local::socket sock(ioc);
+    beast::flat_buffer buf;
+    size_t sent = 0;
+    while (sent < count) {
+        if (!sock.is_open()) sock.connect(local::endpoint(opts.socket));
+        auto n = opts.close ? 1 : std::min(opts.depth, count - sent);
+        asio::write(sock, asio::buffer(batch.data(), raw.size() * n));
+        for (size_t i = 0; i < n; ++i) {
+            http::response<http::string_body> resp;
+            http::read(sock, buf, resp);
+            if (resp.result_int() < 300) {
+                ++counters.ok;
+            } else {
+                ++counters.failed;
+            }
+            if (resp.need_eof()) {
+                sock.close();
+                buf.clear();
+            }
+        }
+        sent += n;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options opts{};
+    CLI::App app("HTTP API load generator");
+    argv = app.ensure_utf8(argv);
+    app.add_option("socket", opts.socket, "Unix socket of the server")
+        ->required();
+    app.add_option("-t,--target", opts.target, "Target to GET")
+        ->default_str(opts.target);
+    app.add_option("-n,--requests", opts.requests, "Total number of requests")
+        ->default_val(opts.requests);
+    app.add_option("-c,--connections", opts.connections,
+                   "Number of concurrent connections")
+        ->default_val(opts.connections);
+    app.add_option("-p,--pipeline", opts.depth,
+                   "Requests in flight per connection")
+        ->default_val(opts.depth);
+    app.add_flag("--close", opts.close, "Open a new connection per request");
+
+    CLI11_PARSE(app, argc, argv);
+    opts.connections = std::max<size_t>(opts.connections, 1);
+    opts.depth = std::max<size_t>(opts.depth, 1);
+
+    Counters counters{};
+    auto start = plai::Clock::now();
+    {
+        std::vector<std::jthread> threads;
+        for (size_t i = 0; i < opts.connections; ++i) {
+            auto count = opts.requests / opts.connections +
+                         (i < opts.requests % opts.connections ? 1 : 0);
+            threads.emplace_back([&opts, &counters, count] {
+                try {
+                    run_connection(opts, count, counters);
+                } catch (const std::exception& e) {
+                    plai::println(stderr, "connection failed: {}", e.what());
+                }
+            });
+        }
+    }
+    auto elapsed = plai::FloatDuration(plai::Clock::now() - start);
+
+    auto total = counters.ok + counters.failed;
+    plai::println("{} requests ({} failed) in {:.3f}s: {:.0f} req/s", total,
+                  counters.failed.load(), elapsed.count(),
+                  static_cast<double>(total) / elapsed.count());
+    return counters.failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
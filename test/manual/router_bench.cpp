@@ -0,0 +1,69 @@
+#include <array>
+#include <plai/format.hpp>
+#include <plai/net/http/router.hpp>
+#include <plai/time.hpp>
+
+namespace http = plai::net::http;
+
+namespace {
+
+struct Service {
+    std::string_view pattern;
+    http::Method methods;
+};
+
+// routes of the REST API
+constexpr std::array SERVICES = {
+    Service{"/plai/v1/_ping", http::METHOD_GET},
+    Service{"/plai/v1/media/{type}/{name}",
+            http::METHOD_GET | http::METHOD_PUT | http::METHOD_DELETE},
+    Service{"/plai/v1/media", http::METHOD_GET},
+    Service{"/plai/v1/media/{type}", http::METHOD_GET},
+    Service{"/plai/v1/play", http::METHOD_POST},
+};
+
+constexpr std::array TARGETS = {
+    std::string_view{"/plai/v1/_ping"},
+    std::string_view{"/plai/v1/media/image/some-image-name"},
+    std::string_view{"/plai/v1/media"},
+    std::string_view{"/plai/v1/media/video"},
+    std::string_view{"/plai/v1/play"},
+    std::string_view{"/plai/v1/nothing/here"},
+};
+
+constexpr size_t ITERATIONS = 1'000'000;
+
+template <class F>
+void bench(std::string_view name, F&& f) {
+    size_t found = 0;
+    auto start = plai::Clock::now();
+    for (size_t i = 0; i < ITERATIONS; ++i) {
+        for (auto tgt : TARGETS) found += f(tgt) ? 1 : 0;
+    }
+    auto elapsed = plai::FloatDuration(plai::Clock::now() - start);
+    auto lookups = static_cast<double>(ITERATIONS * TARGETS.size());
+    plai::println("{:>12}: {:.1f} ns/lookup ({} found)", name,
+                  elapsed.count() / lookups * 1e9, found);
+}
+
+}  // namespace
+
+int main() {
+    // previous dispatch: try every pattern in turn until one parses
+    bench("parse_target", [](std::string_view tgt) {
+        for (const auto& s : SERVICES) {
+            if (!(s.methods & http::METHOD_GET)) continue;
+            if (http::parse_target(s.pattern, tgt)) return true;
+        }
+        return false;
+    });
+
+    http::Router router{};
+    for (size_t i = 0; i < SERVICES.size(); ++i) {
+        router.add(SERVICES.at(i).pattern, SERVICES.at(i).methods, i);
+    }
+    bench("router", [&](std::string_view tgt) {
+        auto res = router.match(tgt, http::METHOD_GET);
+        return res && res->route;
+    });
+}
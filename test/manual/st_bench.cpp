@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <plai/format.hpp>
+#include <plai/st/state_machine.hpp>
+#include <plai/thirdparty/magic_enum.hpp>
+#include <plai/time.hpp>
+
+namespace st = plai::st;
+
+namespace {
+
+constexpr size_t STEPS = 20'000'000;
+constexpr size_t RUNS = 5;
+
+// Same states as mods::player::RootSm and BlendSm, the machines stepped on
+// every render tick, with trivial steps so mostly the dispatch is measured.
+
+enum class RootSt {
+    Init,
+    Vid,
+    Img,
+    Vid2Vid,
+    Vid2Img,
+    Img2Vid,
+    Img2Img,
+    Done,
+};
+
+enum class BlendSt {
+    Init,
+    WatermarkFadeIn,
+    Blend,
+    WatermarkFadeOut,
+    Done,
+};
+
+/**
+ * \brief Machine moving to the next state every `stay` steps, never done
+ * */
+template <class E, bool HOOK>
+struct Cycle {
+    using state_type = E;
+    static constexpr auto LAST = magic_enum::enum_count<E>() - 2;
+
+    // the steps of the player are defined out of line
+    template <E S>
+    [[gnu::noinline]] E step(st::tag_t<S>) {
+        if (--left) return S;
+        left = stay;
+        auto idx = static_cast<size_t>(S);
+        return static_cast<E>(idx == LAST ? 0 : idx + 1);
+    }
+
+    void on_transition(E /*from*/, E /*to*/)
+        requires HOOK
+    {
+        ++transitions;
+    }
+
+    void reset() {}
+
+    size_t stay{1};
+    size_t left{stay};
+    size_t transitions{};
+};
+
+template <class E, bool HOOK>
+void bench(std::string_view name, size_t stay) {
+    auto sm = st::StateMachine<Cycle<E, HOOK>>(Cycle<E, HOOK>{.stay = stay});
+    auto best = plai::FloatDuration::max();
+    for (size_t run = 0; run < RUNS; ++run) {
+        auto start = plai::Clock::now();
+        for (size_t i = 0; i < STEPS; ++i) sm();
+        best = std::min(best, plai::FloatDuration(plai::Clock::now() - start));
+    }
+    plai::println("{:>28}: {:.2f} ns/step", name,
+                  best.count() * 1e9 / static_cast<double>(STEPS));
+}
+
+}  // namespace
+
+int main() {
+    bench<RootSt, false>("RootSt, change every step", 1);
+    bench<RootSt, false>("RootSt, change every 100", 100);
+    bench<RootSt, true>("RootSt, hook every step", 1);
+    bench<BlendSt, false>("BlendSt, change every step", 1);
+    bench<BlendSt, false>("BlendSt, change every 100", 100);
+    bench<BlendSt, true>("BlendSt, hook every step", 1);
+}
@@ -0,0 +1,83 @@
+#include <atomic>
+#include <boost/asio/thread_pool.hpp>
+#include <cstdlib>
+#include <plai/format.hpp>
+#include <plai/sched/steal_pool.hpp>
+#include <plai/time.hpp>
+#include <thread>
+
+namespace sched = plai::sched;
+
+namespace {
+
+constexpr size_t TASKS = 1'000'000;
+constexpr size_t TREE_DEPTH = 20;
+
+/**
+ * \brief Tiny tasks posted from outside the pool
+ * */
+template <class Pool>
+size_t flat(Pool& pool) {
+    std::atomic<size_t> count{0};
+    for (size_t i = 0; i < TASKS; ++i) {
+        sched::post(pool,
+                    [&] { count.fetch_add(1, std::memory_order_relaxed); });
+    }
+    pool.join();
+    return count;
+}
+
+template <class Pool>
+void spawn(Pool& pool, size_t depth, std::atomic<size_t>& count) {
+    count.fetch_add(1, std::memory_order_relaxed);
+    if (depth == 0) return;
+    for (size_t i = 0; i < 2; ++i) {
+        sched::post(pool, [&pool, depth, &count] {
+            spawn(pool, depth - 1, count);
+        });
+    }
+}
+
+/**
+ * \brief Tiny tasks posting two more each, starting from a single one
+ * */
+template <class Pool>
+size_t tree(Pool& pool) {
+    std::atomic<size_t> count{0};
+    sched::post(pool, [&] { spawn(pool, TREE_DEPTH, count); });
+    pool.join();
+    return count;
+}
+
+template <class Pool, class F>
+void bench(std::string_view name, Pool& pool, F&& fn) {
+    auto start = plai::Clock::now();
+    auto tasks = fn(pool);
+    auto elapsed = plai::FloatDuration(plai::Clock::now() - start);
+    plai::println("{:>22}: {:.2f} M tasks/s ({} tasks)", name,
+                  static_cast<double>(tasks) / elapsed.count() / 1e6, tasks);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t threads = argc > 1 ? std::strtoul(argv[1], nullptr, 10)
+                              : std::thread::hardware_concurrency();
+    plai::println("{} threads", threads);
+    {
+        auto pool = boost::asio::thread_pool(threads);
+        bench("asio::thread_pool flat", pool, flat<boost::asio::thread_pool>);
+    }
+    {
+        auto pool = sched::StealPool({.threads = threads});
+        bench("StealPool flat", pool, flat<sched::StealPool>);
+    }
+    {
+        auto pool = boost::asio::thread_pool(threads);
+        bench("asio::thread_pool tree", pool, tree<boost::asio::thread_pool>);
+    }
+    {
+        auto pool = sched::StealPool({.threads = threads});
+        bench("StealPool tree", pool, tree<sched::StealPool>);
+    }
+}
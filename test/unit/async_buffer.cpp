@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/asio/use_future.hpp>
+#include <memory>
+#include <plai/async_buffer.hpp>
+#include <plai/sched/co.hpp>
+#include <thread>
+
+namespace asio = boost::asio;
+namespace sched = plai::sched;
+using namespace std::literals;
+
+/**
+ * \brief Push `0..n` with callbacks, each push started by the previous one
+ * */
+void push_from(plai::RingBuffer<int>& buf, asio::io_context& ctx, int i,
+               int n) {
+    if (i == n) return;
+    plai::async_push(buf, i, asio::bind_executor(ctx, [&buf, &ctx, i, n] {
+                         push_from(buf, ctx, i + 1, n);
+                     }));
+}
+
+void pop_from(plai::RingBuffer<int>& buf, asio::io_context& ctx, int left,
+              int& sum) {
+    if (left == 0) return;
+    plai::async_pop(buf, asio::bind_executor(ctx, [&, left](int val) {
+                        sum += val;
+                        pop_from(buf, ctx, left - 1, sum);
+                    }));
+}
+
+TEST(RingBuffer, Callback) {
+    auto ctx = asio::io_context();
+    auto buf = plai::RingBuffer<int>(2);
+    int sum = 0;
+    pop_from(buf, ctx, 100, sum);
+    push_from(buf, ctx, 0, 100);
+    ctx.run();
+    ASSERT_EQ(sum, 99 * 100 / 2);
+}
+
+TEST(RingBuffer, Future) {
+    auto buf = plai::RingBuffer<int>(1);
+    auto val = plai::async_pop(buf, asio::use_future);
+    ASSERT_EQ(val.wait_for(10ms), std::future_status::timeout);
+    buf.push(1);
+    ASSERT_EQ(val.get(), 1);
+    buf.push(1);
+    auto pushed = plai::async_push(buf, 2, asio::use_future);
+    ASSERT_EQ(pushed.wait_for(10ms), std::future_status::timeout);
+    ASSERT_EQ(buf.pop(), 1);
+    pushed.get();
+    ASSERT_EQ(buf.pop(), 2);
+}
+
+TEST(RingBuffer, KeepsRunning) {
+    auto ctx = asio::io_context();
+    auto buf = plai::RingBuffer<int>(1);
+    int val = 0;
+    plai::async_pop(buf, asio::bind_executor(
+                             ctx, [&](int popped) { val = popped; }));
+    // the pending pop keeps run() from returning until it completes
+    auto thread = std::jthread([&] { ctx.run(); });
+    std::this_thread::sleep_for(10ms);
+    buf.push(1);
+    thread.join();
+    ASSERT_EQ(val, 1);
+}
+
+TEST(RingBuffer, Awaitable) {
+    auto ctx = asio::io_context();
+    auto buf = plai::RingBuffer<std::unique_ptr<int>>(1);
+    int sum = 0;
+    asio::co_spawn(
+        ctx,
+        [&]() -> asio::awaitable<void> {
+            for (int i = 0; i < 10; ++i) {
+                co_await plai::async_push(buf, std::make_unique<int>(i),
+                                          asio::use_awaitable);
+            }
+        },
+        asio::detached);
+    asio::co_spawn(
+        ctx,
+        [&]() -> asio::awaitable<void> {
+            for (int i = 0; i < 10; ++i) {
+                sum += *co_await plai::async_pop(buf, asio::use_awaitable);
+            }
+        },
+        asio::detached);
+    ctx.run();
+    ASSERT_EQ(sum, 45);
+}
+
+sched::Co<void> relay(plai::RingBuffer<int>& in, plai::RingBuffer<int>& out,
+                      int n) {
+    for (int i = 0; i < n; ++i) {
+        auto val = co_await plai::async_pop(in, sched::use_co);
+        co_await plai::async_push(out, val * 2, sched::use_co);
+    }
+}
+
+TEST(RingBuffer, Co) {
+    auto ctx = asio::io_context();
+    auto in = plai::RingBuffer<int>(1);
+    auto out = plai::RingBuffer<int>(1);
+    sched::spawn(ctx, relay(in, out, 3));
+    auto thread = std::jthread([&] { ctx.run(); });
+    for (int i = 0; i < 3; ++i) {
+        in.push(i);
+        ASSERT_EQ(out.pop(), i * 2);
+    }
+}
+
+sched::Co<void> cycle(plai::PersistBuffer<std::unique_ptr<int>>& buf, int n) {
+    auto spare = std::make_unique<int>();
+    for (int i = 0; i < n; ++i) {
+        *spare = i;
+        spare = co_await plai::async_push(buf, std::move(spare), sched::use_co);
+    }
+}
+
+TEST(PersistBuffer, Co) {
+    auto ctx = asio::io_context();
+    auto buf = plai::PersistBuffer<std::unique_ptr<int>>(
+        2, plai::factory, [] { return std::make_unique<int>(); });
+    int sum = 0;
+    sched::spawn(ctx, cycle(buf, 10));
+    sched::spawn(ctx, [](auto& buf, int& sum) -> sched::Co<void> {
+        auto spare = std::make_unique<int>();
+        for (int i = 0; i < 10; ++i) {
+            spare = co_await plai::async_pop(buf, std::move(spare),
+                                             sched::use_co);
+            sum += *spare;
+        }
+    }(buf, sum));
+    ctx.run();
+    ASSERT_EQ(sum, 45);
+}
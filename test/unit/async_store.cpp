@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/asio/use_future.hpp>
+#include <plai/async_store.hpp>
+#include <plai/exceptions.hpp>
+#include <thread>
+
+namespace asio = boost::asio;
+
+std::vector<uint8_t> to_vec(std::string_view str) {
+    return {str.begin(), str.end()};
+}
+
+struct AsyncStoreTest : testing::Test {
+    std::unique_ptr<plai::Store> store = plai::sqlite_store(":memory:");
+    asio::thread_pool pool{1};
+    plai::AsyncStore async{*store, pool.get_executor()};
+};
+
+TEST_F(AsyncStoreTest, Future) {
+    async.async_store("a", to_vec("abc"), asio::use_future).get();
+    auto meta = async.async_inspect("a", asio::use_future).get();
+    ASSERT_TRUE(meta);
+    ASSERT_EQ(meta->bytes, 3);
+    ASSERT_EQ(async.async_read("a", asio::use_future).get(), to_vec("abc"));
+}
+
+TEST_F(AsyncStoreTest, FutureError) {
+    auto res = async.async_read("missing", asio::use_future);
+    ASSERT_THROW(res.get(), plai::ValueError);
+}
+
+TEST_F(AsyncStoreTest, Callback) {
+    store->store("a", to_vec("abc"));
+    std::promise<std::thread::id> done{};
+    async.async_read("a", [&](std::exception_ptr err, std::vector<uint8_t> data) {
+        EXPECT_FALSE(err);
+        EXPECT_EQ(data, to_vec("abc"));
+        done.set_value(std::this_thread::get_id());
+    });
+    // runs on the executor of the store
+    ASSERT_NE(done.get_future().get(), std::this_thread::get_id());
+}
+
+TEST_F(AsyncStoreTest, CallbackError) {
+    std::promise<std::exception_ptr> done{};
+    async.async_read("missing", [&](std::exception_ptr err, auto) {
+        done.set_value(err);
+    });
+    auto err = done.get_future().get();
+    ASSERT_TRUE(err);
+    ASSERT_THROW(std::rethrow_exception(err), plai::ValueError);
+}
+
+TEST_F(AsyncStoreTest, Awaitable) {
+    asio::io_context ioc{};
+    std::optional<plai::BlobMeta> meta{};
+    auto thread = std::this_thread::get_id();
+    asio::co_spawn(
+        ioc,
+        [&]() -> asio::awaitable<void> {
+            co_await async.async_store("a", to_vec("abc"),
+                                       asio::use_awaitable);
+            meta = co_await async.async_inspect("a", asio::use_awaitable);
+            // resumed on the coroutine's executor
+            EXPECT_EQ(std::this_thread::get_id(), thread);
+            EXPECT_THROW(
+                co_await async.async_read("missing", asio::use_awaitable),
+                plai::ValueError);
+        },
+        asio::detached);
+    ioc.run();
+    ASSERT_TRUE(meta);
+    ASSERT_EQ(meta->bytes, 3);
+}
+
+TEST_F(AsyncStoreTest, Reader) {
+    store->store("a", to_vec("abcdef"));
+    auto reader = async.async_reader("a", asio::use_future).get();
+    ASSERT_EQ(reader->size(), 6);
+    std::vector<uint8_t> out(2);
+    ASSERT_EQ(reader->read(4, out), 2);
+    ASSERT_EQ(out, to_vec("ef"));
+}
+
+TEST_F(AsyncStoreTest, ReadRange) {
+    store->store("a", to_vec("abcdef"));
+    ASSERT_EQ(async.async_read_range("a", 1, 3, asio::use_future).get(),
+              to_vec("bcd"));
+    auto res = async.async_read_range("missing", 0, 1, asio::use_future);
+    ASSERT_THROW(res.get(), plai::ValueError);
+}
@@ -53,3 +53,71 @@ TEST(Sha256, Binary) {
         "74f81fe167d99b4cb41d6d0ccda82278caee9f3e2f25d5e5a3936ff3dcec60d0");
 }
 
+
+TEST(Sha256Hasher, Empty) {
+    auto hasher = plai::crypto::Sha256Hasher();
+    ASSERT_EQ(hasher.finish(), plai::crypto::sha256(""));
+}
+
+TEST(Sha256Hasher, Chunks) {
+    // NOLINTNEXTLINE
+    auto input = std::vector<uint8_t>{1, 2, 3, 4, 5};
+    auto hasher = plai::crypto::Sha256Hasher();
+    hasher.update(std::span(input).subspan(0, 2));
+    hasher.update(std::span(input).subspan(2));
+    ASSERT_EQ(hasher.finish(), plai::crypto::sha256(input));
+}
+
+TEST(Sha256Hasher, Reuse) {
+    auto hasher = plai::crypto::Sha256Hasher();
+    hasher.update(std::span<const uint8_t>(
+        reinterpret_cast<const uint8_t*>("foo"), 3));  // NOLINT
+    hasher.finish();
+    hasher.update(std::span<const uint8_t>(
+        reinterpret_cast<const uint8_t*>("bar"), 3));  // NOLINT
+    ASSERT_EQ(
+        plai::to_hex_str(hasher.finish()),
+        "fcde2b2edba56bf408601fb721fe9b5c338d10ee429ea04fae5511b68fbf8fb9");
+}
+
+TEST(ParseSha256, RoundTrip) {
+    auto digest = plai::crypto::sha256("foo");
+    auto res = plai::crypto::parse_sha256(plai::crypto::hex_str(digest));
+    ASSERT_EQ(res, digest);
+}
+
+TEST(ParseSha256, UpperCase) {
+    auto res = plai::crypto::parse_sha256(
+        "2C26B46B68FFC68FF99B453C1D30413413422D706483BFA0F98A5E886266E7AE");
+    ASSERT_EQ(res, plai::crypto::sha256("foo"));
+}
+
+TEST(ParseSha256, Invalid) {
+    ASSERT_FALSE(plai::crypto::parse_sha256(""));
+    ASSERT_FALSE(plai::crypto::parse_sha256("2c26b46b"));
+    ASSERT_FALSE(plai::crypto::parse_sha256(
+        "xc26b46b68ffc68ff99b453c1d30413413422d706483bfa0f98a5e886266e7ae"));
+}
+
+TEST(BackgroundSha256Hasher, Empty) {
+    auto hasher = plai::crypto::BackgroundSha256Hasher();
+    ASSERT_EQ(hasher.finish(), plai::crypto::sha256(""));
+}
+
+TEST(BackgroundSha256Hasher, Chunks) {
+    auto input = std::vector<uint8_t>(1024 * 1024);  // NOLINT
+    for (size_t i = 0; i < input.size(); ++i) input.at(i) = i % 251;  // NOLINT
+    auto hasher = plai::crypto::BackgroundSha256Hasher();
+    auto span = std::span(input);
+    while (!span.empty()) {
+        auto count = std::min<size_t>(span.size(), 1000);  // NOLINT
+        hasher.update(span.subspan(0, count));
+        span = span.subspan(count);
+    }
+    ASSERT_EQ(hasher.finish(), plai::crypto::sha256(input));
+}
+
+TEST(BackgroundSha256Hasher, Discard) {
+    auto hasher = plai::crypto::BackgroundSha256Hasher();
+    hasher.update(std::vector<uint8_t>{1, 2, 3});
+}
@@ -1,6 +1,13 @@
+#include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <deque>
+#include <future>
+#include <limits>
+#include <mutex>
 #include <plai/flow/spec.hpp>
+#include <set>
+#include <thread>
 
 namespace flow = plai::flow;
 namespace sched = plai::sched;
@@ -61,3 +68,261 @@ TEST_F(Pipeline, Produce) {
     ctx.run();
     ASSERT_EQ(int_sink.buf, 2);
 }
+
+/**
+ * \brief Source of a fixed number of items, ready until all are produced
+ * */
+struct Counter final : public flow::Src<int> {
+    explicit Counter(int n) : left(n) {}
+
+    int produce() override {
+        --left;
+        return next++;
+    }
+    bool src_ready() override { return left > 0; }
+
+    int next{0};
+    int left;
+};
+
+/**
+ * \brief Sink taking up to `limit` items
+ * */
+struct Collector final : public flow::Sink<int> {
+    void consume(int val) override { vals.push_back(val); }
+    bool sink_ready() override { return vals.size() < limit; }
+
+    void raise_limit(size_t n) {
+        limit = n;
+        flow::Sink<int>::notify_sink_ready();
+    }
+
+    std::vector<int> vals{};
+    size_t limit{std::numeric_limits<size_t>::max()};
+};
+
+TEST_F(Pipeline, BufferedProduce) {
+    auto pline = flow::pipeline(ctx) | int_src | flow::buffered() | int_sink |
+                 flow::pipeline_finish();
+    sched::post(ctx, [&] { int_src.push(2); });
+    ctx.run();
+    ASSERT_EQ(int_sink.buf, 2);
+}
+
+TEST(BufferedConnector, InOrder) {
+    auto ctx = sched::IoContext();
+    auto src = Counter(100);
+    auto sink = Collector();
+    auto pline = flow::pipeline(ctx) | src |
+                 flow::buffered({.capacity = 4, .batch = 3}) | sink |
+                 flow::pipeline_finish();
+    ctx.run();
+    ASSERT_EQ(sink.vals.size(), 100);
+    for (int i = 0; i < 100; ++i) ASSERT_EQ(sink.vals[i], i);
+}
+
+TEST(BufferedConnector, Backpressure) {
+    auto ctx = sched::IoContext();
+    auto src = Counter(100);
+    auto sink = Collector();
+    sink.limit = 0;
+    auto pline = flow::pipeline(ctx) | src |
+                 flow::buffered({.capacity = 4, .batch = 8}) | sink |
+                 flow::pipeline_finish();
+    ctx.run();
+    // only as many items as the queue holds are taken from the source
+    ASSERT_EQ(src.next, 4);
+    ASSERT_TRUE(sink.vals.empty());
+    ctx.restart();
+    sink.raise_limit(10);
+    ctx.run();
+    ASSERT_EQ(sink.vals.size(), 10);
+    ASSERT_EQ(src.next, 14);
+}
+
+TEST(BufferedConnector, Coalesces) {
+    auto ctx = sched::IoContext();
+    auto src = Counter(0);
+    auto sink = Collector();
+    auto pline = flow::pipeline(ctx) | src | flow::buffered() | sink |
+                 flow::pipeline_finish();
+    ctx.run();
+    ctx.restart();
+    src.left = 10;
+    for (int i = 0; i < 5; ++i) sink.raise_limit(100);
+    // a single wakeup moves all items
+    ASSERT_EQ(ctx.run_one(), 1);
+    ASSERT_EQ(sink.vals.size(), 10);
+    ASSERT_EQ(ctx.poll(), 0);
+}
+
+/**
+ * \brief Proxy that may consume and produce on different threads
+ * */
+struct SharedProxy final : public flow::Sink<int>, public flow::Src<int> {
+    void consume(int val) override {
+        {
+            auto lk = std::lock_guard(mut);
+            buf.push_back(val);
+        }
+        notify_src_ready();
+    }
+    bool sink_ready() override {
+        auto lk = std::lock_guard(mut);
+        return buf.size() < 2;
+    }
+
+    int produce() override {
+        int out{};
+        {
+            auto lk = std::lock_guard(mut);
+            out = buf.front();
+            buf.pop_front();
+        }
+        notify_sink_ready();
+        return out;
+    }
+    bool src_ready() override {
+        auto lk = std::lock_guard(mut);
+        return !buf.empty();
+    }
+
+    std::mutex mut{};
+    std::deque<int> buf{};
+};
+
+/**
+ * \brief Collector that remembers the threads it consumed on
+ * */
+struct ThreadCollector final : public flow::Sink<int> {
+    void consume(int val) override {
+        vals.push_back(val);
+        threads.insert(std::this_thread::get_id());
+        if (vals.size() == expected) done.set_value();
+    }
+    bool sink_ready() override { return true; }
+
+    size_t expected{};
+    std::vector<int> vals{};
+    std::set<std::thread::id> threads{};
+    std::promise<void> done{};
+};
+
+TEST(On, Stages) {
+    constexpr int ITEMS = 2000;
+    auto ctx = sched::IoContext();
+    auto guard = boost::asio::make_work_guard(ctx);
+    auto pool = boost::asio::thread_pool(4);
+    auto src = Counter(ITEMS);
+    auto proxy = SharedProxy();
+    auto sink = ThreadCollector();
+    sink.expected = ITEMS;
+    auto done = sink.done.get_future();
+    auto pline = flow::pipeline(ctx) | src | flow::on(pool) | proxy |
+                 flow::buffered() | flow::on(ctx) | sink |
+                 flow::pipeline_finish();
+    auto thread = std::jthread([&] { ctx.run(); });
+    auto ctx_thread = thread.get_id();
+    ASSERT_EQ(done.wait_for(std::chrono::seconds(10)),
+              std::future_status::ready);
+    ctx.stop();
+    thread.join();
+    pool.join();
+    // delivered in order on the io_context thread
+    ASSERT_THAT(sink.threads, testing::ElementsAre(ctx_thread));
+    for (int i = 0; i < ITEMS; ++i) ASSERT_EQ(sink.vals[i], i);
+}
+
+TEST(FanOut, InOrder) {
+    auto ctx = sched::IoContext();
+    auto src = Counter(100);
+    auto a = SharedProxy();
+    auto b = SharedProxy();
+    auto c = SharedProxy();
+    auto sink = Collector();
+    auto pline = flow::pipeline(ctx) | src | flow::fan_out(a, b, c) |
+                 flow::fan_in() | sink | flow::pipeline_finish();
+    ctx.run();
+    ASSERT_EQ(sink.vals.size(), 100);
+    for (int i = 0; i < 100; ++i) ASSERT_EQ(sink.vals[i], i);
+}
+
+/**
+ * \brief Stage producing `v * 10`, `v * 10 + 1` and `v * 10 + 2` for each `v`
+ * */
+struct Expander final : public flow::Sink<int>, public flow::Src<int> {
+    void consume(int val) override {
+        {
+            auto lk = std::lock_guard(mut);
+            for (int i = 0; i < 3; ++i) buf.push_back(val * 10 + i);
+        }
+        notify_src_ready();
+    }
+    bool sink_ready() override {
+        auto lk = std::lock_guard(mut);
+        return buf.empty();
+    }
+
+    int produce() override {
+        int out{};
+        bool empty{};
+        {
+            auto lk = std::lock_guard(mut);
+            out = buf.front();
+            buf.pop_front();
+            empty = buf.empty();
+        }
+        if (empty) notify_sink_ready();
+        return out;
+    }
+    bool src_ready() override {
+        auto lk = std::lock_guard(mut);
+        return !buf.empty();
+    }
+
+    std::mutex mut{};
+    std::deque<int> buf{};
+};
+
+TEST(FanOut, Groups) {
+    constexpr int ITEMS = 500;
+    auto ctx = sched::IoContext();
+    auto guard = boost::asio::make_work_guard(ctx);
+    auto pool = boost::asio::thread_pool(3);
+    auto src = Counter(ITEMS);
+    auto stages = std::vector<Expander>(3);
+    auto ptrs = std::vector<Expander*>{&stages[0], &stages[1], &stages[2]};
+    auto sink = ThreadCollector();
+    sink.expected = ITEMS * 3;
+    auto done = sink.done.get_future();
+    auto pline = flow::pipeline(ctx) | src | flow::on(pool) |
+                 flow::fan_out(std::span<Expander* const>(ptrs)) |
+                 flow::fan_in([](int v) { return v % 10 == 2; }) |
+                 flow::on(ctx) | sink | flow::pipeline_finish();
+    auto thread = std::jthread([&] { ctx.run(); });
+    auto ctx_thread = thread.get_id();
+    ASSERT_EQ(done.wait_for(std::chrono::seconds(10)),
+              std::future_status::ready);
+    ctx.stop();
+    thread.join();
+    pool.join();
+    ASSERT_THAT(sink.threads, testing::ElementsAre(ctx_thread));
+    for (int i = 0; i < ITEMS * 3; ++i) {
+        ASSERT_EQ(sink.vals[i], i / 3 * 10 + i % 3);
+    }
+}
+
+TEST(FanOut, LastGroups) {
+    // fewer items than stages, each stage gets a single group
+    auto ctx = sched::IoContext();
+    auto src = Counter(2);
+    auto stages = std::vector<Expander>(3);
+    auto ptrs = std::vector<Expander*>{&stages[0], &stages[1], &stages[2]};
+    auto sink = Collector();
+    auto pline = flow::pipeline(ctx) | src |
+                 flow::fan_out(std::span<Expander* const>(ptrs)) |
+                 flow::fan_in([](int v) { return v % 10 == 2; }) | sink |
+                 flow::pipeline_finish();
+    ctx.run();
+    ASSERT_THAT(sink.vals, testing::ElementsAre(0, 1, 2, 10, 11, 12));
+}
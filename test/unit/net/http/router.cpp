@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include <plai/net/http/router.hpp>
+
+using namespace plai::net::http;
+
+TEST(Router, Literal) {
+    Router r{};
+    r.add("/foo", METHOD_GET, 1);
+    r.add("/foo/bar", METHOD_GET, 2);
+    auto res = r.match("/foo", METHOD_GET);
+    ASSERT_TRUE(res);
+    ASSERT_EQ(res->route, 1);
+    ASSERT_EQ(res->target, "/foo");
+    ASSERT_TRUE(res->target.path_params().empty());
+    res = r.match("/foo/bar", METHOD_GET);
+    ASSERT_TRUE(res);
+    ASSERT_EQ(res->route, 2);
+}
+
+TEST(Router, NotFound) {
+    Router r{};
+    r.add("/foo/bar", METHOD_GET, 1);
+    ASSERT_FALSE(r.match("/foo", METHOD_GET));
+    ASSERT_FALSE(r.match("/foo/bar/baz", METHOD_GET));
+    ASSERT_FALSE(r.match("/foo/baz", METHOD_GET));
+    ASSERT_FALSE(r.match("", METHOD_GET));
+}
+
+TEST(Router, Params) {
+    Router r{};
+    r.add("/{a}/{b}/c/{d}/e/{f}", METHOD_GET, 1);
+    auto res = r.match("/aa/bb/c/dd/e/ff", METHOD_GET);
+    ASSERT_TRUE(res);
+    ASSERT_EQ(res->route, 1);
+    const auto& params = res->target.path_params();
+    ASSERT_EQ(params.size(), 4);
+    ASSERT_EQ(params.at("a"), "aa");
+    ASSERT_EQ(params.at("b"), "bb");
+    ASSERT_EQ(params.at("d"), "dd");
+    ASSERT_EQ(params.at("f"), "ff");
+    ASSERT_THROW((void)params.at("c"), std::out_of_range);
+}
+
+TEST(Router, ParamNamesPerPattern) {
+    Router r{};
+    r.add("/media/{type}", METHOD_GET, 1);
+    r.add("/media/{name}/data", METHOD_GET, 2);
+    auto res = r.match("/media/image", METHOD_GET);
+    ASSERT_TRUE(res);
+    ASSERT_EQ(res->route, 1);
+    ASSERT_EQ(res->target.at("type"), "image");
+    res = r.match("/media/foo/data", METHOD_GET);
+    ASSERT_TRUE(res);
+    ASSERT_EQ(res->route, 2);
+    ASSERT_EQ(res->target.at("name"), "foo");
+    ASSERT_FALSE(res->target.path_params().contains("type"));
+}
+
+TEST(Router, LiteralBeforeParam) {
+    Router r{};
+    r.add("/media/{type}", METHOD_GET, 1);
+    r.add("/media/all", METHOD_GET, 2);
+    auto res = r.match("/media/all", METHOD_GET);
+    ASSERT_TRUE(res);
+    ASSERT_EQ(res->route, 2);
+    res = r.match("/media/image", METHOD_GET);
+    ASSERT_TRUE(res);
+    ASSERT_EQ(res->route, 1);
+}
+
+TEST(Router, Backtrack) {
+    Router r{};
+    r.add("/media/all/x", METHOD_GET, 1);
+    r.add("/media/{type}/y", METHOD_GET, 2);
+    auto res = r.match("/media/all/y", METHOD_GET);
+    ASSERT_TRUE(res);
+    ASSERT_EQ(res->route, 2);
+    ASSERT_EQ(res->target.at("type"), "all");
+}
+
+TEST(Router, Methods) {
+    Router r{};
+    r.add("/media/{type}", METHOD_GET | METHOD_DELETE, 1);
+    r.add("/media/{type}", METHOD_PUT, 2);
+    ASSERT_EQ(r.match("/media/image", METHOD_GET)->route, 1);
+    ASSERT_EQ(r.match("/media/image", METHOD_DELETE)->route, 1);
+    ASSERT_EQ(r.match("/media/image", METHOD_PUT)->route, 2);
+    auto res = r.match("/media/image", METHOD_POST);
+    ASSERT_TRUE(res);
+    ASSERT_FALSE(res->route);
+}
+
+TEST(Router, MethodFromOtherBranch) {
+    Router r{};
+    r.add("/media/all", METHOD_GET, 1);
+    r.add("/media/{type}", METHOD_DELETE, 2);
+    auto res = r.match("/media/all", METHOD_DELETE);
+    ASSERT_TRUE(res);
+    ASSERT_EQ(res->route, 2);
+}
+
+TEST(Router, Conflict) {
+    Router r{};
+    r.add("/foo/{a}", METHOD_GET | METHOD_PUT, 1);
+    ASSERT_THROW(r.add("/foo/{b}", METHOD_PUT, 2), plai::ValueError);
+    ASSERT_NO_THROW(r.add("/foo/{b}", METHOD_POST, 3));
+}
+
+TEST(Router, InvalidPattern) {
+    Router r{};
+    ASSERT_THROW(r.add("/foo/{a", METHOD_GET, 1), plai::ValueError);
+    ASSERT_THROW(r.add("/{a}/{b}/{c}/{d}/{e}/{f}/{g}/{h}/{i}", METHOD_GET, 1),
+                 plai::ValueError);
+}
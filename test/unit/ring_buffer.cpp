@@ -55,3 +55,36 @@ TEST(Pop, OverLimit) {
     ASSERT_TRUE(rb.try_pop());
     ASSERT_FALSE(rb.try_pop());
 }
+
+TEST(Push, TryWrapAround) {
+    auto rb = RingBuffer<int>(3);
+    ASSERT_TRUE(rb.try_emplace(0));
+    for (int i = 1; i < 10; ++i) {
+        ASSERT_TRUE(rb.try_emplace(i));
+        ASSERT_EQ(rb.try_pop(), i - 1);
+    }
+}
+
+TEST(When, Space) {
+    auto rb = RingBuffer<int>(1);
+    size_t called = 0;
+    rb.when_space([&] { ++called; });
+    ASSERT_EQ(called, 1);
+    rb.emplace(1);
+    rb.when_space([&] { ++called; });
+    ASSERT_EQ(called, 1);
+    ASSERT_EQ(rb.pop(), 1);
+    ASSERT_EQ(called, 2);
+}
+
+TEST(When, Data) {
+    auto rb = RingBuffer<int>(2);
+    size_t called = 0;
+    rb.when_data([&] { ++called; });
+    rb.when_data([&] { ++called; });
+    ASSERT_EQ(called, 0);
+    ASSERT_TRUE(rb.try_emplace(1));
+    ASSERT_EQ(called, 1);
+    rb.push(2);
+    ASSERT_EQ(called, 2);
+}
@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+
+#include <plai/exceptions.hpp>
+#include <plai/ring_buffer.hpp>
+#include <plai/sched/co.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sched = plai::sched;
+using namespace std::literals;
+
+sched::Co<int> add(int a, int b) { co_return a + b; }
+
+sched::Co<int> add_three(int a, int b, int c) {
+    auto ab = co_await add(a, b);
+    co_return co_await add(ab, c);
+}
+
+TEST(Co, Result) {
+    auto ctx = sched::IoContext();
+    int res = 0;
+    sched::spawn(ctx, [](int& res) -> sched::Co<void> {
+        res = co_await add_three(1, 2, 3);
+    }(res));
+    ASSERT_EQ(res, 0);
+    ctx.run();
+    ASSERT_EQ(res, 6);
+}
+
+sched::Co<int> fail() {
+    throw plai::ValueError("fail");
+    co_return 0;
+}
+
+TEST(Co, Exception) {
+    auto ctx = sched::IoContext();
+    bool caught = false;
+    sched::spawn(ctx, [](bool& caught) -> sched::Co<void> {
+        try {
+            co_await fail();
+        } catch (const plai::ValueError&) {
+            caught = true;
+        }
+        co_await fail();
+    }(caught));
+    ASSERT_THROW(ctx.run(), plai::ValueError);
+    ASSERT_TRUE(caught);
+}
+
+sched::Co<void> count(std::string name, std::vector<std::string>& out) {
+    for (size_t i = 0; i < 3; ++i) {
+        out.push_back(name);
+        co_await sched::yield();
+    }
+}
+
+TEST(Co, Yield) {
+    auto ctx = sched::IoContext();
+    std::vector<std::string> out{};
+    sched::spawn(ctx, count("a", out));
+    sched::spawn(ctx, count("b", out));
+    ctx.run();
+    ASSERT_EQ(out, (std::vector<std::string>{"a", "b", "a", "b", "a", "b"}));
+}
+
+TEST(Co, Sleep) {
+    auto ctx = sched::IoContext();
+    auto start = plai::Clock::now();
+    plai::TimePoint woken{};
+    sched::spawn(ctx, [](plai::TimePoint& woken) -> sched::Co<void> {
+        co_await sched::sleep_for(10ms);
+        woken = plai::Clock::now();
+    }(woken));
+    ctx.run();
+    ASSERT_GE(woken - start, 10ms);
+}
+
+TEST(Co, ResumeOn) {
+    auto ctx = sched::IoContext();
+    auto other = sched::IoContext();
+    auto guard = boost::asio::make_work_guard(other);
+    auto thread = std::jthread([&] { other.run(); });
+    auto other_id = thread.get_id();
+    std::thread::id ran_on{};
+    sched::spawn(ctx, [](sched::Executor exec,
+                         std::thread::id& ran_on) -> sched::Co<void> {
+        co_await sched::resume_on(std::move(exec));
+        ran_on = std::this_thread::get_id();
+    }(other.get_executor(), ran_on));
+    ctx.run();
+    guard.reset();
+    thread.join();
+    ASSERT_EQ(ran_on, other_id);
+}
+
+sched::Co<void> produce(plai::RingBuffer<int>& buf, int n) {
+    for (int i = 0; i < n; ++i) {
+        while (!buf.try_emplace(i)) co_await sched::space(buf);
+    }
+}
+
+sched::Co<void> consume(plai::RingBuffer<int>& buf, int n, int& sum) {
+    for (int i = 0; i < n; ++i) {
+        co_await sched::data(buf);
+        sum += *buf.try_pop();
+    }
+}
+
+TEST(Co, RingBuffer) {
+    // both would block the only thread if they waited on the buffer
+    auto ctx = sched::IoContext();
+    auto buf = plai::RingBuffer<int>(2);
+    int sum = 0;
+    sched::spawn(ctx, consume(buf, 100, sum));
+    sched::spawn(ctx, produce(buf, 100));
+    ctx.run();
+    ASSERT_EQ(sum, 99 * 100 / 2);
+    ASSERT_TRUE(buf.empty());
+}
@@ -0,0 +1,97 @@
+// gcc mistakes the replaced operator delete for a mismatch with new
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <plai/sched/handler_memory.hpp>
+#include <plai/sched/task.hpp>
+#include <plai/util/memfn.hpp>
+
+namespace sched = plai::sched;
+
+namespace {
+std::atomic<size_t> allocs{0};
+}  // namespace
+
+void* operator new(size_t size) {
+    ++allocs;
+    if (auto* ptr = std::malloc(size)) return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+TEST(HandlerMemory, Reuse) {
+    auto mem = sched::HandlerMemory();
+    auto before = allocs.load();
+    auto* a = mem.allocate(64);
+    mem.deallocate(a);
+    auto* b = mem.allocate(64);
+    ASSERT_EQ(a, b);
+    mem.deallocate(b);
+    ASSERT_EQ(allocs, before);
+}
+
+TEST(HandlerMemory, Fallback) {
+    auto mem = sched::HandlerMemory();
+    auto before = allocs.load();
+    std::vector<void*> ptrs{};
+    ptrs.reserve(sched::HandlerMemory::BLOCKS + 2);
+    for (size_t i = 0; i < sched::HandlerMemory::BLOCKS + 1; ++i) {
+        ptrs.push_back(mem.allocate(64));
+    }
+    ptrs.push_back(mem.allocate(sched::HandlerMemory::BLOCK_SIZE + 1));
+    ASSERT_EQ(allocs - before, 3);
+    for (auto* ptr : ptrs) mem.deallocate(ptr);
+}
+
+/**
+ * \brief Task posting itself until it ran `steps` times
+ * */
+struct Repost {
+    explicit Repost(sched::IoContext& ctx, size_t steps)
+        : task(sched::task() | sched::executor(ctx) |
+               plai::memfn(this, &Repost::step) | sched::task_finish()),
+          left(steps) {}
+
+    void step() {
+        if (--left) task.post();
+    }
+
+    sched::Task task;
+    size_t left;
+};
+
+TEST(TaskAlloc, Repost) {
+    auto ctx = sched::IoContext();
+    auto rep = Repost(ctx, 1000);
+    // warm up asio's services
+    rep.task.post();
+    ctx.run_one();
+    auto before = allocs.load();
+    ctx.run();
+    ASSERT_EQ(rep.left, 0);
+    ASSERT_EQ(allocs, before);
+}
+
+TEST(TaskAlloc, PostFromOutside) {
+    auto ctx = sched::IoContext();
+    size_t counter = 0;
+    auto task = sched::task() | sched::executor(ctx) | [&] { ++counter; } |
+                [&] { ++counter; } | sched::task_finish();
+    task.post();
+    ctx.run();
+    auto before = allocs.load();
+    for (size_t i = 0; i < 100; ++i) {
+        ctx.restart();
+        task.post();
+        ctx.run();
+    }
+    ASSERT_EQ(counter, 202);
+    ASSERT_EQ(allocs, before);
+}
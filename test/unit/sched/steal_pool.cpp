@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <future>
+#include <plai/flow/spec.hpp>
+#include <plai/sched/steal_pool.hpp>
+#include <plai/sched/task.hpp>
+#include <thread>
+#include <vector>
+
+namespace sched = plai::sched;
+using namespace std::literals;
+
+TEST(StealPool, RunsAll) {
+    auto pool = sched::StealPool({.threads = 3});
+    ASSERT_EQ(pool.size(), 3);
+    std::atomic<size_t> count{0};
+    {
+        std::vector<std::jthread> posters{};
+        for (size_t i = 0; i < 4; ++i) {
+            posters.emplace_back([&] {
+                for (size_t j = 0; j < 1000; ++j) {
+                    sched::post(pool, [&] { ++count; });
+                }
+            });
+        }
+    }
+    pool.join();
+    ASSERT_EQ(count, 4000);
+}
+
+/**
+ * \brief Post `2^depth` tasks from within the pool
+ * */
+void spawn(sched::StealPool& pool, size_t depth, std::atomic<size_t>& count) {
+    ++count;
+    if (depth == 0) return;
+    for (size_t i = 0; i < 2; ++i) {
+        sched::post(pool, [&pool, depth, &count] {
+            EXPECT_TRUE(pool.get_executor().running_in_this_thread());
+            spawn(pool, depth - 1, count);
+        });
+    }
+}
+
+TEST(StealPool, Nested) {
+    auto pool = sched::StealPool({.threads = 4});
+    std::atomic<size_t> count{0};
+    sched::post(pool, [&] { spawn(pool, 12, count); });
+    pool.join();
+    ASSERT_EQ(count, (1 << 13) - 1);
+    ASSERT_FALSE(pool.get_executor().running_in_this_thread());
+}
+
+TEST(StealPool, Executor) {
+    auto pool = sched::StealPool({.threads = 2});
+    sched::Executor exec = pool.get_executor();
+    std::promise<void> done{};
+    size_t counter = 0;
+    auto task = sched::task() | sched::executor(exec) | [&] { ++counter; } |
+                [&] { done.set_value(); } | sched::task_finish();
+    task.post();
+    ASSERT_EQ(done.get_future().wait_for(10s), std::future_status::ready);
+    ASSERT_EQ(counter, 1);
+}
+
+TEST(StealPool, JoinWaitsForTimer) {
+    auto pool = sched::StealPool({.threads = 2});
+    bool fired = false;
+    auto timer = sched::Timer(pool.get_executor(), 20ms);
+    timer.async_wait([&](auto ec) { fired = !ec; });
+    pool.join();
+    ASSERT_TRUE(fired);
+}
+
+TEST(StealPool, Pipeline) {
+    struct Numbers final : public plai::flow::Src<int> {
+        int produce() override { return next++; }
+        bool src_ready() override { return next < 100; }
+        int next{0};
+    };
+    struct Sum final : public plai::flow::Sink<int> {
+        void consume(int val) override {
+            total += val;
+            if (val == 99) done.set_value();
+        }
+        bool sink_ready() override { return true; }
+        int total{0};
+        std::promise<void> done{};
+    };
+    auto pool = sched::StealPool({.threads = 2});
+    auto src = Numbers();
+    auto sink = Sum();
+    auto done = sink.done.get_future();
+    auto pline = plai::flow::pipeline(pool) | src | plai::flow::buffered() |
+                 sink | plai::flow::pipeline_finish();
+    ASSERT_EQ(done.wait_for(10s), std::future_status::ready);
+    pool.join();
+    ASSERT_EQ(sink.total, 99 * 100 / 2);
+}
+
+TEST(StealPool, Pin) {
+    auto pool = sched::StealPool({.threads = 2, .pin = true});
+    std::promise<void> done{};
+    sched::post(pool, [&] { done.set_value(); });
+    ASSERT_EQ(done.get_future().wait_for(10s), std::future_status::ready);
+}
@@ -1,7 +1,10 @@
 #include <gtest/gtest.h>
 
+#include <optional>
 #include <plai/sched/executor.hpp>
 #include <plai/sched/task.hpp>
+#include <thread>
+#include <vector>
 
 namespace sched = plai::sched;
 using namespace std::literals;
@@ -91,3 +94,125 @@ TEST(PeriodicTask, Run) {
                 [&] { ++counter; } | sched::task_finish();
     while (counter < count) { ctx.poll(); }
 }
+
+/**
+ * \brief Ticks of a task with a 10ms period run right after stalling for 92ms
+ * */
+size_t ticks_after_stall(sched::Overrun overrun, size_t& missed) {
+    auto ctx = sched::IoContext();
+    size_t counter = 0;
+    auto task = sched::task() | sched::executor(ctx) | sched::period(10ms) |
+                sched::overrun(overrun) | [&] { ++counter; } |
+                sched::task_finish();
+    while (counter < 2) { ctx.run_one(); }
+    std::this_thread::sleep_for(92ms);
+    auto stalled = counter;
+    auto until = plai::Clock::now() + 2ms;
+    while (plai::Clock::now() < until) { ctx.poll(); }
+    missed = task.lateness().missed;
+    return counter - stalled;
+}
+
+TEST(PeriodicTask, Skip) {
+    size_t missed = 0;
+    ASSERT_EQ(ticks_after_stall(sched::Overrun::Skip, missed), 1);
+    ASSERT_GE(missed, 8);
+}
+
+TEST(PeriodicTask, CatchUp) {
+    size_t missed = 0;
+    auto ticks = ticks_after_stall(sched::Overrun::CatchUp, missed);
+    ASSERT_EQ(ticks, 1 + sched::PeriodicTask::MAX_CATCH_UP);
+    ASSERT_GE(missed, 8 - sched::PeriodicTask::MAX_CATCH_UP);
+}
+
+TEST(PeriodicTask, Coalesce) {
+    size_t missed = 0;
+    ASSERT_EQ(ticks_after_stall(sched::Overrun::Coalesce, missed), 1);
+    ASSERT_GE(missed, 8);
+}
+
+TEST(PeriodicTask, Lateness) {
+    auto ctx = sched::IoContext();
+    size_t counter = 0;
+    auto task = sched::task() | sched::executor(ctx) | sched::period(1ms) |
+                [&] { ++counter; } | sched::task_finish();
+    while (counter < 20) { ctx.run_one(); }
+    auto late = task.lateness();
+    ASSERT_EQ(late.ticks, counter);
+    size_t total = 0;
+    for (auto n : late.buckets) total += n;
+    ASSERT_EQ(total, late.ticks);
+    ASSERT_GE(late.quantile(1.0), late.quantile(0.5));
+}
+
+TEST(PeriodicTask, Align) {
+    auto ctx = sched::IoContext();
+    std::vector<plai::TimePoint> ticks{};
+    auto task = sched::task() | sched::executor(ctx) | sched::period(20ms) |
+                [&] { ticks.push_back(plai::Clock::now()); } |
+                sched::task_finish();
+    // a grid shifted by a whole number of periods is the same grid
+    auto anchor = plai::Clock::now() + 6ms;
+    task.align(anchor + 100 * 20ms);
+    while (ticks.size() < 2) { ctx.run_one(); }
+    ASSERT_GE(ticks[1], anchor);
+    ASSERT_LT(ticks[1], anchor + 12ms);
+}
+
+TEST(PeriodicTask, Idle) {
+    auto ctx = sched::IoContext();
+    std::vector<plai::TimePoint> ticks{};
+    sched::PeriodicTask* self = nullptr;
+    auto task = sched::task() | sched::executor(ctx) | sched::period(1ms) |
+                [&] {
+                    ticks.push_back(plai::Clock::now());
+                    if (ticks.size() == 1) {
+                        self->idle_until(ticks.back() + 20ms);
+                    } else if (ticks.size() == 2) {
+                        self->idle_until(plai::TimePoint::max());
+                    }
+                } |
+                sched::task_finish();
+    self = &task;
+    while (ticks.size() < 2) { ctx.run_one(); }
+    ASSERT_GE(ticks[1] - ticks[0], 20ms);
+    // idles until woken
+    auto until = plai::Clock::now() + 20ms;
+    while (plai::Clock::now() < until) { ctx.poll(); }
+    ASSERT_EQ(ticks.size(), 2);
+    auto woken = plai::Clock::now();
+    task.wake();
+    while (ticks.size() < 4) { ctx.run_one(); }
+    ASSERT_LT(ticks[2] - woken, 20ms);
+}
+
+TEST(PeriodicTask, WakeDestroyed) {
+    auto ctx = sched::IoContext();
+    std::optional<sched::PeriodicTask> task{};
+    bool idle = false;
+    task.emplace(sched::task() | sched::executor(ctx) | sched::period(1ms) |
+                 [&] {
+                     task->idle_until(plai::TimePoint::max());
+                     idle = true;
+                 } |
+                 sched::task_finish());
+    while (!idle) { ctx.run_one(); }
+    // the wake-up runs after the task is gone
+    task->wake();
+    task.reset();
+    ctx.run();
+}
+
+TEST(PeriodicTask, WakeBusy) {
+    auto ctx = sched::IoContext();
+    size_t counter = 0;
+    auto task = sched::task() | sched::executor(ctx) | sched::period(50ms) |
+                [&] { ++counter; } | sched::task_finish();
+    while (counter < 1) { ctx.run_one(); }
+    // not idle, so no extra tick
+    task.wake();
+    auto until = plai::Clock::now() + 20ms;
+    while (plai::Clock::now() < until) { ctx.poll(); }
+    ASSERT_EQ(counter, 1);
+}
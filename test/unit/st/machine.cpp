@@ -1,8 +1,11 @@
 #include <gtest/gtest.h>
 
 #include <plai/st/state_machine.hpp>
+#include <utility>
+#include <vector>
 
 namespace st = plai::st;
+using namespace std::literals;
 enum class StA {
     Init,
     A,
@@ -102,3 +105,73 @@ TEST(Sm, Param) {
     sm(0);
     ASSERT_TRUE(sm.done());
 }
+
+struct Hooked {
+    using enum StA;
+    using state_type = StA;
+
+    state_type step(st::tag_t<Init>) { return A; }
+    state_type step(st::tag_t<A>) { return stay ? A : B; }
+    state_type step(st::tag_t<B>) { return Done; }
+
+    void on_transition(state_type from, state_type to) {
+        transitions.emplace_back(from, to);
+    }
+
+    void reset() {}
+
+    bool stay{true};
+    std::vector<std::pair<StA, StA>> transitions{};
+};
+
+TEST(Sm, Hook) {
+    using enum StA;
+    auto sm = st::StateMachine<Hooked>();
+    sm();
+    sm();
+    sm->stay = false;
+    sm();
+    sm();
+    ASSERT_TRUE(sm.done());
+    auto expected =
+        std::vector<std::pair<StA, StA>>{{Init, A}, {A, B}, {B, Done}};
+    ASSERT_EQ(sm->transitions, expected);
+}
+
+struct Waking {
+    using enum StA;
+    using state_type = StA;
+
+    state_type step(st::tag_t<Init>) { return A; }
+    state_type step(st::tag_t<A>) { return B; }
+    state_type step(st::tag_t<B>) { return Done; }
+
+    st::Wake wake(st::tag_t<A>) const { return st::Wake::at(deadline); }
+    st::Wake wake(st::tag_t<B>) const { return st::Wake::on_input(); }
+
+    void reset() {}
+
+    plai::TimePoint deadline{};
+};
+
+TEST(Sm, Wake) {
+    using enum StA;
+    auto deadline = plai::Clock::now();
+    auto sm = st::StateMachine<Waking>({.deadline = deadline});
+    ASSERT_EQ(sm.wake(), st::Wake::tick());
+    sm();
+    ASSERT_EQ(sm.wake(), st::Wake::at(deadline));
+    sm();
+    ASSERT_TRUE(sm.wake().input);
+    sm();
+    ASSERT_EQ(sm.wake(), st::Wake::never());
+}
+
+TEST(Wake, Merge) {
+    auto now = plai::Clock::now();
+    auto wake =
+        st::Wake::at(now + 1s) | st::Wake::at(now) | st::Wake::on_input();
+    ASSERT_EQ(wake.deadline, now);
+    ASSERT_TRUE(wake.input);
+    ASSERT_TRUE((st::Wake::tick() | st::Wake::never()).ticking());
+}
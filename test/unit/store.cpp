@@ -1,33 +1,125 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <sqlite3.h>
 
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
 #include <plai/crypto.hpp>
+#include <plai/exceptions.hpp>
 #include <plai/store.hpp>
+#include <plai/store_compactor.hpp>
+
+using namespace std::chrono_literals;
 
 using testing::ElementsAre;
 using testing::UnorderedElementsAre;
 
-auto mk_store() { return plai::sqlite_store(":memory:"); }
+enum class Backend { Sqlite, Fs };
+
+std::string backend_name(const testing::TestParamInfo<Backend>& info) {
+    return info.param == Backend::Sqlite ? "Sqlite" : "Fs";
+}
+
+/**
+ * \brief Runs every test against each Store implementation
+ * */
+class StoreTest : public testing::TestWithParam<Backend> {
+ protected:
+    void TearDown() override {
+        for (const auto& dir : m_dirs) std::filesystem::remove_all(dir);
+    }
+
+    /// Fresh directory removed after the test
+    std::filesystem::path temp_dir() {
+        auto tmpl = (std::filesystem::temp_directory_path() /
+                     "plai-store-test-XXXXXX")
+                        .string();
+        auto* path = mkdtemp(tmpl.data());
+        if (!path) throw std::runtime_error("failed to create temp dir");
+        return m_dirs.emplace_back(path);
+    }
+
+    /// Open a persistent store at `path` inside a temp_dir()
+    std::unique_ptr<plai::Store> open_store(const std::filesystem::path& path,
+                                            const plai::SqliteOpts& opts = {}) {
+        if (GetParam() == Backend::Sqlite) {
+            return plai::sqlite_store(path.string(), opts);
+        }
+        return plai::fs_store(path.string(), opts);
+    }
+
+    std::unique_ptr<plai::Store> mk_store() {
+        if (GetParam() == Backend::Sqlite) return plai::sqlite_store(":memory:");
+        return open_store(temp_dir() / "store");
+    }
+
+ private:
+    std::vector<std::filesystem::path> m_dirs{};
+};
+
+#define STORE_TEST_SUITE(name)                                               \
+    class name : public StoreTest {};                                        \
+    INSTANTIATE_TEST_SUITE_P(, name,                                         \
+                             testing::Values(Backend::Sqlite, Backend::Fs), \
+                             backend_name)
+
+STORE_TEST_SUITE(Init);
+STORE_TEST_SUITE(List);
+STORE_TEST_SUITE(Store);
+STORE_TEST_SUITE(Inspect);
+STORE_TEST_SUITE(Lock);
+STORE_TEST_SUITE(Unlock);
+STORE_TEST_SUITE(Remove);
+STORE_TEST_SUITE(Read);
+STORE_TEST_SUITE(Writer);
+STORE_TEST_SUITE(Link);
+STORE_TEST_SUITE(Dedup);
+STORE_TEST_SUITE(ReadRange);
+STORE_TEST_SUITE(Compact);
+STORE_TEST_SUITE(StoreMany);
 
 std::span<const uint8_t> span_cast(std::span<const char> spn) {
     return {reinterpret_cast<const uint8_t*>(spn.data()), spn.size()};
 }
 
-TEST(Init, Create) { mk_store(); }
+TEST_P(Init, Create) { mk_store(); }
 
-TEST(List, Empty) {
+TEST_P(Init, Reopen) {
+    auto path = temp_dir() / "store";
+    {
+        auto db = open_store(
+            path, {.synchronous = plai::SqliteOpts::Synchronous::Full,
+                   .mmap_size = 0,
+                   .cache_size_kib = 64});
+        db->store("foo", span_cast("bar"));
+        // statements are reused across calls
+        db->store("bar", span_cast("baz"));
+        ASSERT_TRUE(db->inspect("foo"));
+        ASSERT_TRUE(db->inspect("foo"));
+    }
+    {
+        auto db = open_store(path);
+        ASSERT_THAT(db->list(), UnorderedElementsAre("foo", "bar"));
+        auto span = span_cast("baz");
+        auto expected = std::vector<uint8_t>(span.begin(), span.end());
+        ASSERT_EQ(db->read("bar"), expected);
+    }
+}
+
+TEST_P(List, Empty) {
     auto db = mk_store();
     ASSERT_TRUE(db->list().empty());
 }
 
-TEST(Store, One) {
+TEST_P(Store, One) {
     auto db = mk_store();
     db->store("foo", span_cast("bar"));
     auto res = db->list();
     ASSERT_THAT(res, ElementsAre("foo"));
 }
 
-TEST(Store, Multiple) {
+TEST_P(Store, Multiple) {
     auto db = mk_store();
     db->store("foo", span_cast("bar"));
     db->store("bar", span_cast("baz"));
@@ -36,13 +128,13 @@ TEST(Store, Multiple) {
     ASSERT_THAT(res, UnorderedElementsAre("foo", "bar", "baz"));
 }
 
-TEST(Inspect, Miss) {
+TEST_P(Inspect, Miss) {
     auto db = mk_store();
     auto res = db->inspect("foo");
     ASSERT_FALSE(res);
 }
 
-TEST(Inspect, Match) {
+TEST_P(Inspect, Match) {
     auto db = mk_store();
     db->store("foo", span_cast("bar"));
     auto res = db->inspect("foo");
@@ -52,7 +144,7 @@ TEST(Inspect, Match) {
     ASSERT_EQ(res->sha256, expected);
 }
 
-TEST(Store, Overwrite) {
+TEST_P(Store, Overwrite) {
     auto db = mk_store();
     db->store("foo", span_cast("bar"));
     db->store("foo", span_cast("baz"));
@@ -64,7 +156,7 @@ TEST(Store, Overwrite) {
     ASSERT_EQ(res->sha256, plai::crypto::sha256(span_cast("baz")));
 }
 
-TEST(Store, OverwriteSome) {
+TEST_P(Store, OverwriteSome) {
     auto db = mk_store();
     db->store("a", span_cast("a"));
     db->store("b", span_cast("b"));
@@ -79,7 +171,7 @@ TEST(Store, OverwriteSome) {
     ASSERT_EQ(res->sha256, plai::crypto::sha256(span_cast("foo")));
 }
 
-TEST(Lock, OneMatch) {
+TEST_P(Lock, OneMatch) {
     auto db = mk_store();
     db->store("a", span_cast("a"));
     auto res = db->inspect("a");
@@ -93,7 +185,7 @@ TEST(Lock, OneMatch) {
     ASSERT_TRUE(res->locked);
 }
 
-TEST(Lock, MultiMatch) {
+TEST_P(Lock, MultiMatch) {
     auto db = mk_store();
     db->store("a", span_cast("a"));
     db->store("b", span_cast("b"));
@@ -109,7 +201,7 @@ TEST(Lock, MultiMatch) {
     ASSERT_FALSE(res.value().locked);
 }
 
-TEST(Lock, SingleMismatch) {
+TEST_P(Lock, SingleMismatch) {
     auto db = mk_store();
     db->store("a", span_cast("a"));
     auto keys = std::vector<plai::CStr>{"b"};
@@ -119,7 +211,7 @@ TEST(Lock, SingleMismatch) {
     ASSERT_FALSE(res.value().locked);
 }
 
-TEST(Lock, MultiMisMatch) {
+TEST_P(Lock, MultiMisMatch) {
     auto db = mk_store();
     db->store("a", span_cast("a"));
     db->store("b", span_cast("b"));
@@ -128,6 +220,7 @@ TEST(Lock, MultiMisMatch) {
     auto keys = std::vector<plai::CStr>{"a", "b", "c", "d"};
     auto success = db->lock(keys);
     ASSERT_FALSE(success);
+    ASSERT_THAT(success.missing, ElementsAre("d"));
     keys.pop_back();
     for (const auto k : keys) {
         auto res = db->inspect(k);
@@ -135,18 +228,44 @@ TEST(Lock, MultiMisMatch) {
     }
 }
 
-TEST(Unlock, One) {
+TEST_P(Lock, KeepsLocked) {
+    auto db = mk_store();
+    db->store("a", span_cast("a"));
+    auto locked = std::vector<plai::CStr>{"a"};
+    ASSERT_TRUE(db->lock(locked));
+    // a failed lock leaves previously locked keys alone
+    auto keys = std::vector<plai::CStr>{"x", "a", "y"};
+    auto res = db->lock(keys);
+    ASSERT_THAT(res.missing, ElementsAre("x", "y"));
+    ASSERT_TRUE(db->inspect("a").value().locked);
+}
+
+TEST_P(Lock, Many) {
+    auto db = mk_store();
+    std::vector<std::string> names{};
+    for (int i = 0; i < 500; ++i) {
+        names.push_back("key\"" + std::to_string(i));
+        db->store(names.back(), span_cast("a"));
+    }
+    std::vector<plai::CStr> keys(names.begin(), names.end());
+    ASSERT_TRUE(db->lock(keys));
+    ASSERT_TRUE(db->inspect(keys.back()).value().locked);
+    db->unlock(keys);
+    ASSERT_FALSE(db->inspect(keys.front()).value().locked);
+}
+
+TEST_P(Unlock, One) {
     auto db = mk_store();
     db->store("a", span_cast("a"));
     auto keys = std::vector<plai::CStr>{"a"};
-    bool success = db->lock(keys);
+    auto success = db->lock(keys);
     ASSERT_TRUE(success);
     db->unlock(keys);
     auto res = db->inspect("a");
     ASSERT_FALSE(res.value().locked);
 }
 
-TEST(Unlock, Many) {
+TEST_P(Unlock, Many) {
     auto db = mk_store();
     db->store("a", span_cast("a"));
     db->store("b", span_cast("b"));
@@ -162,7 +281,7 @@ TEST(Unlock, Many) {
     ASSERT_TRUE(db->inspect("c").value().locked);
 }
 
-TEST(Remove, One) {
+TEST_P(Remove, One) {
     auto db = mk_store();
     db->store("a", span_cast("a"));
     db->remove("a");
@@ -170,7 +289,7 @@ TEST(Remove, One) {
     ASSERT_TRUE(ls.empty());
 }
 
-TEST(Remove, OneLocked) {
+TEST_P(Remove, OneLocked) {
     auto db = mk_store();
     db->store("a", span_cast("a"));
     auto keys = std::vector<plai::CStr>{"a"};
@@ -181,7 +300,7 @@ TEST(Remove, OneLocked) {
     ASSERT_TRUE(res->marked_for_deletion);
 }
 
-TEST(Remove, UnlockMarked) {
+TEST_P(Remove, UnlockMarked) {
     auto db = mk_store();
     db->store("a", span_cast("a"));
     auto keys = std::vector<plai::CStr>{"a"};
@@ -192,7 +311,7 @@ TEST(Remove, UnlockMarked) {
     ASSERT_TRUE(ls.empty());
 }
 
-TEST(Read, Simple) {
+TEST_P(Read, Simple) {
     auto db = mk_store();
     auto span = span_cast("a");
     auto expected = std::vector<uint8_t>(span.begin(), span.end());
@@ -200,3 +319,488 @@ TEST(Read, Simple) {
     auto res = db->read("a");
     ASSERT_EQ(res, expected);
 }
+
+TEST_P(Writer, Chunks) {
+    auto db = mk_store();
+    auto data = span_cast("foobarbaz");
+    auto writer = db->writer("a", data.size());
+    writer->write(data.subspan(0, 3));
+    writer->write(data.subspan(3, 3));
+    writer->write(data.subspan(6));
+    auto meta = writer->commit();
+    ASSERT_EQ(meta.bytes, data.size());
+    ASSERT_EQ(meta.sha256, plai::crypto::sha256(data));
+    auto res = db->inspect("a");
+    ASSERT_TRUE(res);
+    ASSERT_EQ(res->bytes, data.size());
+    ASSERT_EQ(res->sha256, meta.sha256);
+    auto read = db->read("a");
+    ASSERT_TRUE(std::ranges::equal(read, data));
+}
+
+TEST_P(Writer, Overwrite) {
+    auto db = mk_store();
+    db->store("a", span_cast("a"));
+    auto data = span_cast("bar");
+    auto writer = db->writer("a", data.size());
+    writer->write(data);
+    writer->commit();
+    ASSERT_THAT(db->list(), ElementsAre("a"));
+    ASSERT_EQ(db->inspect("a").value().sha256, plai::crypto::sha256(data));
+}
+
+TEST_P(Writer, Discard) {
+    auto db = mk_store();
+    db->store("a", span_cast("a"));
+    {
+        auto writer = db->writer("a", 4);
+        writer->write(span_cast("b"));
+    }
+    ASSERT_EQ(db->inspect("a").value().sha256,
+              plai::crypto::sha256(span_cast("a")));
+    {
+        auto writer = db->writer("b", 4);
+        writer->write(span_cast("b"));
+    }
+    ASSERT_FALSE(db->inspect("b"));
+}
+
+TEST_P(Writer, Overflow) {
+    auto db = mk_store();
+    auto writer = db->writer("a", 1);
+    ASSERT_THROW(writer->write(span_cast("a")), plai::ValueError);
+}
+
+TEST_P(Writer, Incomplete) {
+    auto db = mk_store();
+    auto writer = db->writer("a", 3);
+    writer->write(span_cast("a"));
+    ASSERT_THROW(writer->commit(), plai::ValueError);
+}
+
+TEST_P(Writer, Digest) {
+    auto db = mk_store();
+    auto data = span_cast("foo");
+    auto writer = db->writer("a", data.size(), plai::crypto::sha256(data));
+    writer->write(data);
+    writer->commit();
+    ASSERT_TRUE(db->inspect("a"));
+}
+
+TEST_P(Writer, DigestMismatch) {
+    auto db = mk_store();
+    auto data = span_cast("foo");
+    auto writer =
+        db->writer("a", data.size(), plai::crypto::sha256(span_cast("bar")));
+    writer->write(data);
+    ASSERT_THROW(writer->commit(), plai::DigestMismatch);
+    writer.reset();
+    ASSERT_FALSE(db->inspect("a"));
+}
+
+TEST_P(Writer, BackgroundHashing) {
+    auto db = mk_store();
+    auto data = std::vector<uint8_t>(32 * 1024 * 1024);  // NOLINT
+    data.back() = 1;
+    auto writer = db->writer("a", data.size());
+    auto span = std::span<const uint8_t>(data);
+    while (!span.empty()) {
+        auto count = std::min<size_t>(span.size(), 1024 * 1024);  // NOLINT
+        writer->write(span.subspan(0, count));
+        span = span.subspan(count);
+    }
+    auto meta = writer->commit();
+    ASSERT_EQ(meta.sha256, plai::crypto::sha256(data));
+    ASSERT_EQ(db->read("a"), data);
+}
+
+TEST_P(Link, Missing) {
+    auto db = mk_store();
+    auto digest = plai::crypto::sha256(span_cast("a"));
+    ASSERT_FALSE(db->link("a", digest));
+    ASSERT_FALSE(db->inspect("a"));
+}
+
+TEST_P(Link, Existing) {
+    auto db = mk_store();
+    auto span = span_cast("abc");
+    db->store("a", span);
+    auto res = db->link("b", plai::crypto::sha256(span));
+    ASSERT_TRUE(res);
+    ASSERT_EQ(res->bytes, span.size());
+    ASSERT_EQ(res->sha256, plai::crypto::sha256(span));
+    ASSERT_THAT(db->list(), UnorderedElementsAre("a", "b"));
+    auto expected = std::vector<uint8_t>(span.begin(), span.end());
+    ASSERT_EQ(db->read("b"), expected);
+}
+
+TEST_P(Dedup, RemoveShared) {
+    auto db = mk_store();
+    auto span = span_cast("abc");
+    auto expected = std::vector<uint8_t>(span.begin(), span.end());
+    db->store("a", span);
+    db->store("b", span);
+    db->remove("a");
+    ASSERT_EQ(db->read("b"), expected);
+    db->remove("b");
+    ASSERT_FALSE(db->link("c", plai::crypto::sha256(span)));
+}
+
+TEST_P(Dedup, Overwrite) {
+    auto db = mk_store();
+    auto span = span_cast("abc");
+    db->store("a", span);
+    db->store("b", span);
+    db->store("a", span_cast("def"));
+    auto expected = std::vector<uint8_t>(span.begin(), span.end());
+    ASSERT_EQ(db->read("b"), expected);
+    db->store("b", span_cast("def"));
+    ASSERT_FALSE(db->link("c", plai::crypto::sha256(span)));
+}
+
+TEST_P(Dedup, LockedShared) {
+    auto db = mk_store();
+    auto span = span_cast("abc");
+    db->store("a", span);
+    db->store("b", span);
+    auto keys = std::vector<plai::CStr>{"a"};
+    db->lock(keys);
+    db->remove("a");
+    db->remove("b");
+    ASSERT_THAT(db->list(), ElementsAre("a"));
+    db->unlock(keys);
+    ASSERT_TRUE(db->list().empty());
+    ASSERT_FALSE(db->link("c", plai::crypto::sha256(span)));
+}
+
+TEST_P(Dedup, Writer) {
+    auto db = mk_store();
+    auto span = span_cast("abc");
+    auto expected = std::vector<uint8_t>(span.begin(), span.end());
+    db->store("a", span);
+    auto w = db->writer("b", span.size());
+    w->write(span);
+    w->commit();
+    db->remove("a");
+    ASSERT_EQ(db->read("b"), expected);
+    db->remove("b");
+    ASSERT_FALSE(db->link("c", plai::crypto::sha256(span)));
+}
+
+TEST_P(ReadRange, Parts) {
+    auto db = mk_store();
+    auto as_vec = [](std::string_view str) {
+        return std::vector<uint8_t>(str.begin(), str.end());
+    };
+    db->store("a", as_vec("abcdef"));
+    ASSERT_EQ(db->read_range("a", 0, 3), as_vec("abc"));
+    ASSERT_EQ(db->read_range("a", 4, 10), as_vec("ef"));
+    ASSERT_TRUE(db->read_range("a", 6, 1).empty());
+    ASSERT_THROW(db->read_range("b", 0, 1), plai::ValueError);
+}
+
+TEST_P(ReadRange, Reader) {
+    auto db = mk_store();
+    std::vector<uint8_t> data(100'000);
+    for (size_t i = 0; i < data.size(); ++i) data[i] = i % 251;
+    db->store("a", data);
+    auto reader = db->reader("a");
+    ASSERT_EQ(reader->size(), data.size());
+    std::vector<uint8_t> buf(4096);
+    // backwards, like a demuxer looking for an index at the end
+    for (size_t off = data.size(); off > 0;) {
+        off -= std::min(off, buf.size());
+        auto n = reader->read(off, buf);
+        ASSERT_EQ(n, std::min(buf.size(), data.size() - off));
+        ASSERT_TRUE(std::equal(buf.begin(), buf.begin() + n,
+                               data.begin() + off));
+    }
+    ASSERT_EQ(reader->read(data.size(), buf), 0);
+}
+
+TEST_P(ReadRange, Snapshot) {
+    auto db = mk_store();
+    db->store("a", span_cast("abc"));
+    auto reader = db->reader("a");
+    db->store("a", span_cast("xyz"));
+    db->remove("a");
+    std::vector<uint8_t> buf(4);
+    ASSERT_EQ(reader->read(0, buf), 4);
+    ASSERT_EQ(buf, (std::vector<uint8_t>{'a', 'b', 'c', '\0'}));
+}
+
+TEST_P(ReadRange, SnapshotOnDisk) {
+    auto db = open_store(temp_dir() / "store");
+    db->store("a", span_cast("abc"));
+    auto reader = db->reader("a");
+    db->store("a", span_cast("xyz"));
+    db->remove("a");
+    std::vector<uint8_t> buf(4);
+    ASSERT_EQ(reader->read(0, buf), 4);
+    ASSERT_EQ(buf, (std::vector<uint8_t>{'a', 'b', 'c', '\0'}));
+}
+
+TEST_P(ReadRange, SnapshotRenewed) {
+    // readers move to newer snapshots on every read
+    auto db = open_store(temp_dir() / "store", {.max_snapshot_age = {}});
+    db->store("a", span_cast("abc"));
+    db->store("b", span_cast("abc"));
+    auto reader = db->reader("a");
+    std::vector<uint8_t> buf(4);
+    const auto expected = std::vector<uint8_t>{'a', 'b', 'c', '\0'};
+    db->store("c", span_cast("xyz"));
+    ASSERT_EQ(reader->read(0, buf), 4);
+    ASSERT_EQ(buf, expected);
+    // the payload is still there under "b"
+    db->remove("a");
+    ASSERT_EQ(reader->read(0, buf), 4);
+    ASSERT_EQ(buf, expected);
+    // gone, the reader keeps its snapshot
+    db->remove("b");
+    ASSERT_EQ(reader->read(0, buf), 4);
+    ASSERT_EQ(buf, expected);
+}
+
+/**
+ * \brief Store blobs with distinct content and remove them again
+ * */
+void store_and_remove(plai::Store& db, size_t count) {
+    std::vector<uint8_t> blob(16 * 1024);
+    for (size_t i = 0; i < count; ++i) {
+        std::fill(blob.begin(), blob.end(), static_cast<uint8_t>(i));
+        db.store(std::to_string(i), blob);
+    }
+    for (size_t i = 0; i < count; ++i) db.remove(std::to_string(i));
+}
+
+TEST_P(Compact, Steps) {
+    auto db = mk_store();
+    store_and_remove(*db, 32);
+    const auto initial = db->compact(0);
+    ASSERT_EQ(initial.freed_pages, 0);
+    ASSERT_GT(initial.page_size, 0);
+    if (GetParam() == Backend::Sqlite) {
+        ASSERT_GT(initial.free_pages, 8);
+    }
+    size_t freed = 0;
+    for (auto free = initial.free_pages; free;) {
+        auto stats = db->compact(8);
+        ASSERT_GT(stats.freed_pages, 0);
+        ASSERT_LE(stats.freed_pages, 8);
+        freed += stats.freed_pages;
+        free = stats.free_pages;
+    }
+    ASSERT_EQ(freed, initial.free_pages);
+    ASSERT_EQ(db->compact(8).freed_pages, 0);
+    db->store("a", span_cast("abc"));
+    ASSERT_EQ(db->read("a").size(), 4);
+}
+
+TEST_P(Compact, Reopen) {
+    auto path = temp_dir() / "store";
+    open_store(path)->store("a", span_cast("abc"));
+    auto db = open_store(path);
+    store_and_remove(*db, 8);
+    ASSERT_EQ(db->compact(1'000).free_pages, 0);
+    ASSERT_EQ(db->read("a").size(), 4);
+}
+
+TEST(StoreCompactor, OnlyWhenIdle) {
+    auto db = plai::sqlite_store(":memory:");
+    store_and_remove(*db, 32);
+    const auto initial = db->compact(0);
+    plai::sched::IoContext ioc{};
+    std::atomic<bool> idle{false};
+    auto compactor = plai::StoreCompactor(
+        *db, ioc.get_executor(), [&] { return idle.load(); },
+        {.period = 1ms, .pages_per_step = 4});
+    ioc.run_for(20ms);
+    ASSERT_EQ(compactor.metrics().steps, 0);
+    idle = true;
+    for (auto end = plai::Clock::now() + 5s;
+         compactor.metrics().freed_pages < initial.free_pages &&
+         plai::Clock::now() < end;) {
+        ioc.run_for(10ms);
+    }
+    auto metrics = compactor.metrics();
+    ASSERT_GT(metrics.steps, 1);
+    ASSERT_EQ(metrics.freed_pages, initial.free_pages);
+    ASSERT_EQ(metrics.freed_bytes, initial.free_pages * initial.page_size);
+    ASSERT_EQ(metrics.free_pages, 0);
+}
+
+TEST_P(StoreMany, Batch) {
+    auto db = mk_store();
+    db->store("a", span_cast("old"));
+    const auto items = std::vector<plai::StoreItem>{
+        {.key = "a", .blob = span_cast("abc")},
+        {.key = "b", .blob = span_cast("def"),
+         .digest = plai::crypto::sha256(span_cast("def"))},
+        // same content as "a"
+        {.key = "c", .blob = span_cast("abc")},
+    };
+    db->store_many(items);
+    ASSERT_THAT(db->list(), UnorderedElementsAre("a", "b", "c"));
+    ASSERT_EQ(db->inspect("a")->sha256, plai::crypto::sha256(span_cast("abc")));
+    ASSERT_EQ(db->inspect("b")->sha256, plai::crypto::sha256(span_cast("def")));
+    ASSERT_EQ(db->read("c"), db->read("a"));
+    db->store_many({});
+    ASSERT_EQ(db->list().size(), 3);
+}
+
+/**
+ * \brief Opens databases written by older versions with sqlite_store()
+ *
+ * The old layouts are created with raw SQL, as no code writes them anymore.
+ * */
+class Migrate : public testing::Test {
+ protected:
+    void SetUp() override {
+        auto tmpl = (std::filesystem::temp_directory_path() /
+                     "plai-migrate-test-XXXXXX")
+                        .string();
+        auto* dir = mkdtemp(tmpl.data());
+        ASSERT_TRUE(dir);
+        m_dir = dir;
+        m_path = m_dir / "store.db";
+    }
+
+    void TearDown() override { std::filesystem::remove_all(m_dir); }
+
+    /// Run `sql` on the database without going through a store
+    void exec(const std::string& sql) {
+        auto* db = open_raw();
+        char* err{};
+        auto res = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &err);
+        std::string msg = err ? err : "";
+        sqlite3_free(err);
+        sqlite3_close(db);
+        ASSERT_EQ(res, SQLITE_OK) << msg;
+    }
+
+    /// First column of the single row `sql` returns
+    int64_t query(const std::string& sql) {
+        auto* db = open_raw();
+        sqlite3_stmt* stmt{};
+        int64_t out = -1;
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) ==
+                SQLITE_OK &&
+            sqlite3_step(stmt) == SQLITE_ROW) {
+            out = sqlite3_column_int64(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+        sqlite3_close(db);
+        return out;
+    }
+
+    /// SQL literal of the digest of `str`
+    static std::string digest_of(std::string_view str) {
+        return "X'" +
+               plai::crypto::hex_str(plai::crypto::sha256(as_bytes(str))) +
+               "'";
+    }
+
+    static std::vector<uint8_t> as_bytes(std::string_view str) {
+        return {str.begin(), str.end()};
+    }
+
+    std::filesystem::path m_path{};
+
+ private:
+    sqlite3* open_raw() {
+        sqlite3* db{};
+        if (sqlite3_open(m_path.c_str(), &db) != SQLITE_OK)
+            throw std::runtime_error(sqlite3_errmsg(db));
+        return db;
+    }
+
+    std::filesystem::path m_dir{};
+};
+
+TEST_F(Migrate, FromV0) {
+    // payloads stored inline with the metadata
+    exec("CREATE TABLE plai (name STRING PRIMARY KEY, sha256 BLOB, "
+         "bytes INTEGER, locked BOOLEAN, marked_for_deletion BOOLEAN, "
+         "data BLOB);"
+         "INSERT INTO plai VALUES ('a', " +
+         digest_of("abc") +
+         ", 3, 0, 0, X'616263');"
+         "INSERT INTO plai VALUES ('b', " +
+         digest_of("de") + ", 2, 1, 0, X'6465');");
+    {
+        auto db = plai::sqlite_store(m_path.string());
+        ASSERT_THAT(db->list(), UnorderedElementsAre("a", "b"));
+        ASSERT_EQ(db->read("a"), as_bytes("abc"));
+        ASSERT_EQ(db->read_range("b", 1, 1), as_bytes("e"));
+        auto meta = db->inspect("b");
+        ASSERT_TRUE(meta);
+        ASSERT_EQ(meta->bytes, 2);
+        ASSERT_EQ(meta->sha256, plai::crypto::sha256(as_bytes("de")));
+        ASSERT_TRUE(meta->locked);
+        ASSERT_FALSE(db->inspect("a")->locked);
+        // still locked after the migration, so only marked
+        db->remove("b");
+        ASSERT_TRUE(db->inspect("b")->marked_for_deletion);
+        std::array<plai::CStr, 1> keys{"b"};
+        db->unlock(keys);
+        ASSERT_THAT(db->list(), ElementsAre("a"));
+    }
+    ASSERT_EQ(query("PRAGMA user_version;"), 2);
+    ASSERT_EQ(query("SELECT count(*) FROM sqlite_master WHERE name='plai';"),
+              0);
+    // reopening does not migrate again
+    auto db = plai::sqlite_store(m_path.string());
+    ASSERT_EQ(db->read("a"), as_bytes("abc"));
+}
+
+TEST_F(Migrate, FromV1) {
+    // separate payloads, duplicates not merged yet
+    exec("CREATE TABLE media (name TEXT PRIMARY KEY, sha256 BLOB, "
+         "bytes INTEGER, locked BOOLEAN, marked_for_deletion BOOLEAN, "
+         "payload INTEGER) WITHOUT ROWID;"
+         "CREATE TABLE payload (id INTEGER PRIMARY KEY, data BLOB);"
+         "CREATE TRIGGER media_delete AFTER DELETE ON media BEGIN "
+         "DELETE FROM payload WHERE id=OLD.payload; END;"
+         "CREATE TRIGGER media_replace AFTER UPDATE OF payload ON media "
+         "WHEN OLD.payload IS NOT NEW.payload BEGIN "
+         "DELETE FROM payload WHERE id=OLD.payload; END;"
+         "INSERT INTO payload VALUES (1, X'616263'), (2, X'616263'), "
+         "(3, X'6465');"
+         "INSERT INTO media VALUES ('a', " +
+         digest_of("abc") + ", 3, 0, 0, 1), ('b', " + digest_of("abc") +
+         ", 3, 0, 0, 2), ('c', " + digest_of("de") +
+         ", 2, 0, 0, 3);"
+         "PRAGMA user_version=1;");
+    {
+        auto db = plai::sqlite_store(m_path.string());
+        ASSERT_THAT(db->list(), UnorderedElementsAre("a", "b", "c"));
+    }
+    ASSERT_EQ(query("PRAGMA user_version;"), 2);
+    ASSERT_EQ(query("SELECT count(*) FROM payload;"), 2);
+    ASSERT_EQ(query("SELECT refs FROM payload WHERE id=1;"), 2);
+    ASSERT_EQ(query("SELECT refs FROM payload WHERE id=3;"), 1);
+    auto db = plai::sqlite_store(m_path.string());
+    ASSERT_EQ(db->read("b"), as_bytes("abc"));
+    // the shared payload stays for the other key
+    db->remove("a");
+    ASSERT_EQ(db->read("b"), as_bytes("abc"));
+    ASSERT_EQ(db->read("c"), as_bytes("de"));
+    db.reset();
+    ASSERT_EQ(query("SELECT refs FROM payload WHERE id=1;"), 1);
+    db = plai::sqlite_store(m_path.string());
+    db->remove("b");
+    db.reset();
+    ASSERT_EQ(query("SELECT count(*) FROM payload;"), 1);
+}
+
+TEST_F(Migrate, RebuildForCompaction) {
+    exec("PRAGMA auto_vacuum=NONE;"
+         "CREATE TABLE plai (name STRING PRIMARY KEY, sha256 BLOB, "
+         "bytes INTEGER, locked BOOLEAN, marked_for_deletion BOOLEAN, "
+         "data BLOB);");
+    // not rebuilt unless asked to, as that may take long
+    plai::sqlite_store(m_path.string());
+    ASSERT_EQ(query("PRAGMA auto_vacuum;"), 0);
+    plai::sqlite_store(m_path.string(), {.rebuild_for_compaction = true});
+    ASSERT_EQ(query("PRAGMA auto_vacuum;"), 2);
+}
@@ -0,0 +1,78 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <plai/store.hpp>
+#include <plai/store_import.hpp>
+
+using testing::ElementsAre;
+
+namespace stdfs = std::filesystem;
+
+class Import : public testing::Test {
+ protected:
+    void SetUp() override {
+        auto tmpl =
+            (stdfs::temp_directory_path() / "plai-import-test-XXXXXX").string();
+        auto* dir = mkdtemp(tmpl.data());
+        ASSERT_NE(dir, nullptr);
+        m_dir = dir;
+    }
+
+    void TearDown() override { stdfs::remove_all(m_dir); }
+
+    void add(const stdfs::path& rel, std::string_view content) {
+        auto path = m_dir / rel;
+        stdfs::create_directories(path.parent_path());
+        std::ofstream(path, std::ios::binary) << content;
+    }
+
+    stdfs::path m_dir;
+};
+
+TEST(ImportKey, OnlyMedia) {
+    EXPECT_EQ(plai::import_key("image/a.png"), "image/a.png");
+    EXPECT_EQ(plai::import_key("video/b.mp4"), "video/b.mp4");
+    EXPECT_EQ(plai::import_key("README"), std::nullopt);
+    EXPECT_EQ(plai::import_key("image"), std::nullopt);
+    EXPECT_EQ(plai::import_key("misc/x.png"), std::nullopt);
+    EXPECT_EQ(plai::import_key("image/a/b.png"), std::nullopt);
+    EXPECT_EQ(plai::import_key("image/.DS_Store"), std::nullopt);
+}
+
+TEST_F(Import, SkipsOtherFiles) {
+    add("image/a.png", "a");
+    add("image/b.png", "b");
+    add("video/c.mp4", "c");
+    add("README", "readme");
+    add(".DS_Store", "x");
+    add("misc/x.png", "x");
+    add("image/nested/d.png", "d");
+    auto store = plai::sqlite_store(":memory:");
+
+    auto stats = plai::import_dir(*store, m_dir, {.jobs = 2});
+
+    EXPECT_EQ(stats.imported, 3);
+    EXPECT_EQ(stats.ignored, 4);
+    EXPECT_THAT(store->list(),
+                ElementsAre("image/a.png", "image/b.png", "video/c.mp4"));
+}
+
+TEST_F(Import, Again) {
+    add("image/a.png", "a");
+    add("video/big.mp4", std::string(64, 'v'));
+    auto store = plai::sqlite_store(":memory:");
+    // the video is larger than a batch and streamed
+    auto opts = plai::ImportOpts{.jobs = 1, .batch_bytes = 16};
+
+    auto first = plai::import_dir(*store, m_dir, opts);
+    auto second = plai::import_dir(*store, m_dir, opts);
+
+    EXPECT_EQ(first.imported, 2);
+    EXPECT_EQ(first.bytes, 65);
+    EXPECT_EQ(second.imported, 0);
+    EXPECT_EQ(second.skipped, 2);
+    EXPECT_EQ(store->read("video/big.mp4").size(), 64);
+}
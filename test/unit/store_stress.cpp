@@ -0,0 +1,190 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <future>
+#include <plai/exceptions.hpp>
+#include <plai/store.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+enum class Backend { Sqlite, Fs };
+
+std::string backend_name(const testing::TestParamInfo<Backend>& info) {
+    return info.param == Backend::Sqlite ? "Sqlite" : "Fs";
+}
+
+/**
+ * \brief Stores on disk used from several threads at once
+ * */
+class Concurrent : public testing::TestWithParam<Backend> {
+ protected:
+    void SetUp() override {
+        auto tmpl = (std::filesystem::temp_directory_path() /
+                     "plai-store-stress-XXXXXX")
+                        .string();
+        auto* path = mkdtemp(tmpl.data());
+        ASSERT_TRUE(path);
+        m_dir = path;
+    }
+
+    void TearDown() override { std::filesystem::remove_all(m_dir); }
+
+    std::unique_ptr<plai::Store> mk_store(const plai::SqliteOpts& opts = {}) {
+        auto path = (m_dir / "store").string();
+        if (GetParam() == Backend::Sqlite) {
+            return plai::sqlite_store(path, opts);
+        }
+        return plai::fs_store(path, opts);
+    }
+
+ private:
+    std::filesystem::path m_dir{};
+};
+
+INSTANTIATE_TEST_SUITE_P(, Concurrent,
+                         testing::Values(Backend::Sqlite, Backend::Fs),
+                         backend_name);
+
+constexpr size_t BLOB_SIZE = 64 * 1024;
+
+/**
+ * \brief Blob whose content identifies the key and version it was stored as
+ * */
+std::vector<uint8_t> make_blob(size_t key, size_t version) {
+    std::vector<uint8_t> out(BLOB_SIZE);
+    for (size_t i = 0; i < out.size(); ++i) {
+        out[i] = static_cast<uint8_t>(key * 31 + version * 7 + i);
+    }
+    out[0] = static_cast<uint8_t>(key);
+    out[1] = static_cast<uint8_t>(version);
+    return out;
+}
+
+bool is_valid_blob(size_t key, const std::vector<uint8_t>& blob) {
+    if (blob.size() != BLOB_SIZE || blob[0] != key) return false;
+    return blob == make_blob(key, blob[1]);
+}
+
+std::string key_name(size_t key) { return "key" + std::to_string(key); }
+
+TEST_P(Concurrent, ReadWhileWriting) {
+    constexpr size_t KEYS = 16;
+    constexpr size_t VERSIONS = 20;
+    auto db = mk_store({.max_readers = 3});
+    for (size_t k = 0; k < KEYS; ++k) db->store(key_name(k), make_blob(k, 0));
+
+    std::atomic<bool> done{false};
+    std::atomic<size_t> invalid{0};
+    std::atomic<size_t> reads{0};
+    std::vector<std::jthread> readers{};
+    for (size_t r = 0; r < 6; ++r) {
+        readers.emplace_back([&, r] {
+            for (size_t i = r; !done; ++i) {
+                auto k = i % KEYS;
+                // keys are only removed and stored again by the writer
+                try {
+                    if (!is_valid_blob(k, db->read(key_name(k)))) ++invalid;
+                } catch (const plai::ValueError&) {
+                }
+                auto meta = db->inspect(key_name(k));
+                if (meta && meta->bytes != BLOB_SIZE) ++invalid;
+                if (db->list().size() > KEYS) ++invalid;
+                ++reads;
+            }
+        });
+    }
+
+    std::vector<std::jthread> writers{};
+    for (size_t w = 0; w < 2; ++w) {
+        writers.emplace_back([&, w] {
+            for (size_t v = 1; v < VERSIONS; ++v) {
+                for (size_t k = w; k < KEYS; k += 2) {
+                    auto name = key_name(k);
+                    if (v % 5 == 0) {
+                        db->remove(name);
+                        db->store(name, make_blob(k, v));
+                        continue;
+                    }
+                    auto blob = make_blob(k, v);
+                    auto writer = db->writer(name, blob.size());
+                    auto half = std::span(blob).subspan(0, blob.size() / 2);
+                    writer->write(half);
+                    writer->write(std::span(blob).subspan(half.size()));
+                    writer->commit();
+                }
+            }
+        });
+    }
+    writers.clear();
+    done = true;
+    readers.clear();
+
+    EXPECT_EQ(invalid, 0);
+    EXPECT_GT(reads, 0);
+    ASSERT_EQ(db->list().size(), KEYS);
+    for (size_t k = 0; k < KEYS; ++k) {
+        ASSERT_EQ(db->read(key_name(k)), make_blob(k, VERSIONS - 1));
+    }
+}
+
+TEST_P(Concurrent, UploadDoesNotBlock) {
+    auto db = mk_store();
+    db->store("a", make_blob(0, 0));
+    auto blob = make_blob(1, 0);
+    auto writer = db->writer("b", blob.size());
+    writer->write(std::span(blob).subspan(0, 10));
+
+    // other threads can read and write while the upload is in progress
+    auto res = std::async(std::launch::async, [&] {
+        auto data = db->read("a");
+        auto keys = std::vector<plai::CStr>{"a"};
+        auto locked = static_cast<bool>(db->lock(keys));
+        db->store("c", make_blob(2, 0));
+        return data == make_blob(0, 0) && locked;
+    });
+    ASSERT_EQ(res.wait_for(10s), std::future_status::ready);
+    ASSERT_TRUE(res.get());
+    ASSERT_FALSE(db->inspect("b"));
+
+    writer->write(std::span(blob).subspan(10));
+    writer->commit();
+    ASSERT_EQ(db->read("b"), blob);
+    ASSERT_THAT(db->list(), testing::UnorderedElementsAre("a", "b", "c"));
+}
+
+TEST_P(Concurrent, SingleReader) {
+    auto db = mk_store({.max_readers = 1});
+    db->store("a", make_blob(0, 0));
+    std::atomic<size_t> ok{0};
+    {
+        std::vector<std::jthread> threads{};
+        for (size_t i = 0; i < 4; ++i) {
+            threads.emplace_back([&] {
+                for (size_t j = 0; j < 50; ++j) {
+                    if (is_valid_blob(0, db->read("a"))) ++ok;
+                }
+            });
+        }
+    }
+    ASSERT_EQ(ok, 200);
+}
+
+TEST_P(Concurrent, DiscardedUpload) {
+    {
+        auto db = mk_store();
+        auto blob = make_blob(0, 0);
+        auto writer = db->writer("a", blob.size());
+        writer->write(std::span(blob).subspan(0, 10));
+    }
+    auto db = mk_store();
+    ASSERT_TRUE(db->list().empty());
+    db->store("a", make_blob(0, 0));
+    ASSERT_EQ(db->read("a"), make_blob(0, 0));
+}